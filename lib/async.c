@@ -0,0 +1,507 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+/* Backend of glyr_get_async() and glyr_get_batch().
+ *
+ * Queries are run by glyr_get() on a small pool of library owned
+ * threads. Found items and finished queries are not reported from
+ * there, but queued as events; the application is woken up through
+ * a file descriptor and calls glyr_dispatch() from its main loop,
+ * which runs the callbacks on the application's thread.
+ *
+ * A batch uses a pool of its own and blocks until it's done.
+ *
+ * glyr_cleanup() stops whatever still runs; every query gets its
+ * on_done, those that never started with GLYRE_STOP_PRE.
+ */
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef __linux__
+#define GLYR_USE_EVENTFD 1
+#include <sys/eventfd.h>
+#endif
+
+#include "async.h"
+#include "glyr.h"
+
+/////////////////////////////////
+
+struct async_job
+{
+    GlyrQuery * query;
+    GlyrAsyncItemCB on_item;
+    GlyrAsyncDoneCB on_done;
+    void * userdata;
+
+    /* glyr_opt_dlcallback() of the query, still called on the worker */
+    DL_callback user_download;
+    void * user_pointer;
+
+    /* Got a worker, protected by async_jobs_lock */
+    gboolean started;
+};
+
+struct async_event
+{
+    struct async_job * job;
+    GlyrMemCache * item;  /* A copy of a found item, or NULL if job is done */
+    GlyrMemCache * list;
+    GLYR_ERROR error;
+    int length;
+};
+
+/////////////////////////////////
+
+static GMutex async_lock;
+static GThreadPool * async_pool = NULL;
+static GAsyncQueue * async_events = NULL;
+
+/* Queries of glyr_get_async() running at the same time, more wait in line */
+static gint async_max_workers = GLYR_DEFAULT_ASYNC_WORKERS;
+
+/* Set while async_destroy() runs, no new queries are taken then */
+static gboolean async_stopping = FALSE;
+
+/* Submitted jobs whose query did not finish yet, protected by async_jobs_lock */
+static GList * async_jobs = NULL;
+static GMutex async_jobs_lock;
+
+/* Set by async_destroy(), queued jobs are not started anymore then; protected by async_jobs_lock */
+static gboolean async_jobs_dropped = FALSE;
+
+/* Readable while events are pending; both ends are the same with eventfd */
+static int async_read_fd = -1;
+static int async_write_fd = -1;
+
+/* Running glyr_get_batch() calls, protected by async_lock; batch_cond is signalled when it drops to 0 */
+static gint batch_running = 0;
+static GCond batch_cond;
+
+/////////////////////////////////
+
+static void async_wakeup (void)
+{
+#ifdef GLYR_USE_EVENTFD
+    guint64 one = 1;
+    while (write (async_write_fd,&one,sizeof (one) ) == -1 && errno == EINTR);
+#elif defined(G_OS_UNIX)
+    gchar one = 1;
+    while (write (async_write_fd,&one,sizeof (one) ) == -1 && errno == EINTR);
+#endif
+}
+
+/////////////////////////////////
+
+static void async_drain_fd (void)
+{
+#ifdef GLYR_USE_EVENTFD
+    guint64 counter;
+    while (read (async_read_fd,&counter,sizeof (counter) ) == -1 && errno == EINTR);
+#elif defined(G_OS_UNIX)
+    gchar buffer[64];
+    while (read (async_read_fd,buffer,sizeof (buffer) ) > 0);
+#endif
+}
+
+/////////////////////////////////
+
+static void async_push (struct async_event * event)
+{
+    g_async_queue_push (async_events,event);
+    async_wakeup();
+}
+
+/////////////////////////////////
+
+/* Installed as download callback of the query while it runs */
+static GLYR_ERROR async_item_cb (GlyrMemCache * item, GlyrQuery * query)
+{
+    struct async_job * job = query->callback.user_pointer;
+    GLYR_ERROR result = GLYRE_OK;
+
+    if (job->user_download != NULL)
+    {
+        query->callback.user_pointer = job->user_pointer;
+        result = job->user_download (item,query);
+        query->callback.user_pointer = job;
+    }
+
+    if (job->on_item != NULL && result != GLYRE_SKIP && result != GLYRE_STOP_PRE)
+    {
+        struct async_event * event = g_malloc0 (sizeof (struct async_event) );
+        event->job = job;
+        event->item = DL_copy (item);
+        async_push (event);
+    }
+    return result;
+}
+
+/////////////////////////////////
+
+static void async_run_job (gpointer data, gpointer unused)
+{
+    struct async_job * job = data;
+    GlyrQuery * query = job->query;
+
+    /* async_destroy() hands it back untouched */
+    g_mutex_lock (&async_jobs_lock);
+    job->started = (async_jobs_dropped == FALSE);
+    g_mutex_unlock (&async_jobs_lock);
+    if (job->started == FALSE)
+    {
+        return;
+    }
+
+    job->user_download = query->callback.download;
+    job->user_pointer = query->callback.user_pointer;
+    query->callback.download = async_item_cb;
+    query->callback.user_pointer = job;
+
+    struct async_event * event = g_malloc0 (sizeof (struct async_event) );
+    event->job = job;
+    event->list = glyr_get (query,&event->error,&event->length);
+
+    query->callback.download = job->user_download;
+    query->callback.user_pointer = job->user_pointer;
+
+    /* async_destroy() might have stopped it meanwhile, don't leave it stopped */
+    g_mutex_lock (&async_jobs_lock);
+    async_jobs = g_list_remove (async_jobs,job);
+    SET_ATOMIC_SIGNAL_EXIT (query,0);
+    g_mutex_unlock (&async_jobs_lock);
+
+    async_push (event);
+}
+
+/////////////////////////////////
+
+/* Needs async_lock */
+static gboolean async_setup (void)
+{
+    if (async_pool != NULL)
+    {
+        return TRUE;
+    }
+
+#ifdef GLYR_USE_EVENTFD
+    async_read_fd = async_write_fd = eventfd (0,EFD_NONBLOCK | EFD_CLOEXEC);
+    if (async_read_fd == -1)
+    {
+        glyr_message (-1,NULL,"Error: eventfd(): %s\n",strerror (errno) );
+        return FALSE;
+    }
+#elif defined(G_OS_UNIX)
+    int fds[2];
+    if (pipe (fds) == -1)
+    {
+        glyr_message (-1,NULL,"Error: pipe(): %s\n",strerror (errno) );
+        return FALSE;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        fcntl (fds[i],F_SETFL,fcntl (fds[i],F_GETFL) | O_NONBLOCK);
+        fcntl (fds[i],F_SETFD,FD_CLOEXEC);
+    }
+    async_read_fd = fds[0];
+    async_write_fd = fds[1];
+#endif
+
+    async_events = g_async_queue_new();
+    async_pool = g_thread_pool_new (async_run_job,NULL,async_max_workers,FALSE,NULL);
+    return TRUE;
+}
+
+/////////////////////////////////
+
+void async_configure (gint max_workers)
+{
+    g_mutex_lock (&async_lock);
+    async_max_workers = (max_workers > 0) ? max_workers : GLYR_DEFAULT_ASYNC_WORKERS;
+    if (async_pool != NULL)
+    {
+        g_thread_pool_set_max_threads (async_pool,async_max_workers,NULL);
+    }
+    g_mutex_unlock (&async_lock);
+}
+
+/////////////////////////////////
+
+GLYR_ERROR async_submit (GlyrQuery * query, GlyrAsyncItemCB on_item, GlyrAsyncDoneCB on_done, void * userdata)
+{
+    GLYR_ERROR result = GLYRE_OK;
+    g_mutex_lock (&async_lock);
+    if (async_stopping == TRUE)
+    {
+        result = GLYRE_NO_INIT;
+    }
+    else if (async_setup() == FALSE)
+    {
+        result = GLYRE_UNKNOWN;
+    }
+    else
+    {
+        struct async_job * job = g_malloc0 (sizeof (struct async_job) );
+        job->query = query;
+        job->on_item = on_item;
+        job->on_done = on_done;
+        job->userdata = userdata;
+
+        g_mutex_lock (&async_jobs_lock);
+        async_jobs = g_list_prepend (async_jobs,job);
+        g_mutex_unlock (&async_jobs_lock);
+
+        g_thread_pool_push (async_pool,job,NULL);
+    }
+    g_mutex_unlock (&async_lock);
+    return result;
+}
+
+/////////////////////////////////
+
+int async_get_fd (void)
+{
+    g_mutex_lock (&async_lock);
+    async_setup();
+    int fd = async_read_fd;
+    g_mutex_unlock (&async_lock);
+    return fd;
+}
+
+/////////////////////////////////
+
+int async_dispatch (void)
+{
+    g_mutex_lock (&async_lock);
+    GAsyncQueue * events = (async_events) ? g_async_queue_ref (async_events) : NULL;
+    if (events != NULL)
+    {
+        async_drain_fd();
+    }
+    g_mutex_unlock (&async_lock);
+
+    if (events == NULL)
+    {
+        return 0;
+    }
+
+    /* Callbacks may submit new queries, those are handled next time */
+    int dispatched = 0;
+    for (int pending = g_async_queue_length (events); pending > 0; pending--)
+    {
+        struct async_event * event = g_async_queue_try_pop (events);
+        if (event == NULL)
+        {
+            break;
+        }
+
+        struct async_job * job = event->job;
+        if (event->item != NULL)
+        {
+            job->on_item (job->query,event->item,job->userdata);
+            DL_free (event->item);
+        }
+        else
+        {
+            if (job->on_done != NULL)
+            {
+                job->on_done (job->query,event->list,event->error,event->length,job->userdata);
+            }
+            else
+            {
+                glyr_free_list (event->list);
+            }
+            g_free (job);
+        }
+        g_free (event);
+        dispatched++;
+    }
+
+    g_async_queue_unref (events);
+    return dispatched;
+}
+
+/////////////////////////////////
+
+/* Waits for running batches, stops running queries and skips queued ones.
+ * on_done is still called for each of them, from here; undispatched items are dropped.
+ */
+void async_destroy (void)
+{
+    g_mutex_lock (&async_lock);
+    while (batch_running > 0)
+    {
+        g_cond_wait (&batch_cond,&async_lock);
+    }
+
+    /* Callbacks are called without the lock, they may not start new queries */
+    GThreadPool * pool = async_pool;
+    GAsyncQueue * events = async_events;
+    async_pool = NULL;
+    async_events = NULL;
+    async_stopping = TRUE;
+    g_mutex_unlock (&async_lock);
+
+    if (pool != NULL)
+    {
+        /* Only stop running queries, queued ones belong to the caller as they are */
+        g_mutex_lock (&async_jobs_lock);
+        async_jobs_dropped = TRUE;
+        for (GList * elem = async_jobs; elem; elem = elem->next)
+        {
+            struct async_job * job = elem->data;
+            if (job->started == TRUE)
+            {
+                glyr_signal_exit (job->query);
+            }
+        }
+        g_mutex_unlock (&async_jobs_lock);
+
+        /* Returns once the running ones noticed, queued ones are not started at all */
+        g_thread_pool_free (pool,TRUE,TRUE);
+
+        struct async_event * event = NULL;
+        while ( (event = g_async_queue_try_pop (events) ) != NULL)
+        {
+            struct async_job * job = event->job;
+            if (event->item != NULL)
+            {
+                DL_free (event->item);
+            }
+            else if (job->on_done != NULL)
+            {
+                job->on_done (job->query,event->list,event->error,event->length,job->userdata);
+                g_free (job);
+            }
+            else
+            {
+                glyr_free_list (event->list);
+                g_free (job);
+            }
+            g_free (event);
+        }
+        g_async_queue_unref (events);
+
+        /* Left are the ones that never ran; their query was not touched */
+        for (GList * elem = async_jobs; elem; elem = elem->next)
+        {
+            struct async_job * job = elem->data;
+            if (job->on_done != NULL)
+            {
+                job->on_done (job->query,NULL,GLYRE_STOP_PRE,0,job->userdata);
+            }
+            g_free (job);
+        }
+        g_list_free (async_jobs);
+        async_jobs = NULL;
+
+        g_mutex_lock (&async_jobs_lock);
+        async_jobs_dropped = FALSE;
+        g_mutex_unlock (&async_jobs_lock);
+    }
+
+    g_mutex_lock (&async_lock);
+    if (async_read_fd != -1)
+    {
+        close (async_read_fd);
+    }
+    if (async_write_fd != -1 && async_write_fd != async_read_fd)
+    {
+        close (async_write_fd);
+    }
+    async_read_fd = async_write_fd = -1;
+    async_stopping = FALSE;
+    g_mutex_unlock (&async_lock);
+}
+
+/////////////////////////////////
+
+struct batch_state
+{
+    GMutex lock;
+    GlyrBatchStats stats;
+};
+
+/////////////////////////////////
+
+static void batch_run_query (gpointer data, gpointer user_data)
+{
+    GlyrQuery * query = data;
+    struct batch_state * batch = user_data;
+
+    GLYR_ERROR error = GLYRE_OK;
+    int length = 0;
+
+    /* Items were delivered through the query's callback already */
+    GlyrMemCache * list = glyr_get (query,&error,&length);
+    glyr_free_list (list);
+
+    g_mutex_lock (&batch->lock);
+    batch->stats.items += length;
+    if (length > 0)
+    {
+        batch->stats.found++;
+    }
+    if (error != GLYRE_OK)
+    {
+        batch->stats.failed++;
+    }
+    g_mutex_unlock (&batch->lock);
+}
+
+/////////////////////////////////
+
+void async_run_batch (GlyrQuery ** queries, gsize n, gint parallel, GlyrBatchStats * stats)
+{
+    struct batch_state batch;
+    memset (&batch,0,sizeof (batch) );
+    g_mutex_init (&batch.lock);
+
+    g_mutex_lock (&async_lock);
+    batch_running++;
+    g_mutex_unlock (&async_lock);
+
+    gint64 started = g_get_monotonic_time();
+    GThreadPool * pool = g_thread_pool_new (batch_run_query,&batch,MAX (parallel,1),FALSE,NULL);
+    for (gsize i = 0; i < n; i++)
+    {
+        g_thread_pool_push (pool,queries[i],NULL);
+    }
+
+    /* Wait for all of them */
+    g_thread_pool_free (pool,FALSE,TRUE);
+    g_mutex_clear (&batch.lock);
+
+    g_mutex_lock (&async_lock);
+    if (--batch_running == 0)
+    {
+        g_cond_broadcast (&batch_cond);
+    }
+    g_mutex_unlock (&async_lock);
+
+    batch.stats.queries = n;
+    batch.stats.seconds = (g_get_monotonic_time() - started) / (gdouble) G_USEC_PER_SEC;
+    batch.stats.queries_per_second = (batch.stats.seconds > 0) ? n / batch.stats.seconds : 0;
+    if (stats != NULL)
+    {
+        *stats = batch.stats;
+    }
+}
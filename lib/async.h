@@ -0,0 +1,32 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+#ifndef GLYR_ASYNC_H
+#define GLYR_ASYNC_H
+
+#include "core.h"
+
+void async_configure (gint max_workers);
+GLYR_ERROR async_submit (GlyrQuery * query, GlyrAsyncItemCB on_item, GlyrAsyncDoneCB on_done, void * userdata);
+int async_get_fd (void);
+int async_dispatch (void);
+void async_run_batch (GlyrQuery ** queries, gsize n, gint parallel, GlyrBatchStats * stats);
+void async_destroy (void);
+
+#endif
@@ -84,6 +84,25 @@ static const char * sqlcode[] =
     "INSERT OR IGNORE INTO image_types VALUES('png');                            \n"
     "INSERT OR IGNORE INTO image_types VALUES('gif');                            \n"
     "INSERT OR IGNORE INTO image_types VALUES('tiff');                           \n"
+    "                                                                            \n"
+    "-- Observed provider performance, see provstats.c                           \n"
+    "CREATE TABLE IF NOT EXISTS provider_stats(                                  \n"
+    "                     get_type INTEGER,                                      \n"
+    "                     provider_name VARCHAR(20),                             \n"
+    "                     samples INTEGER,                                       \n"
+    "                     success_rate FLOAT,                                    \n"
+    "                     useful_rate FLOAT,                                     \n"
+    "                     latency BLOB,                                          \n"
+    "                     UNIQUE(get_type,provider_name)                         \n"
+    ");                                                                          \n"
+    "-- Providers that found nothing for a query, see glyr_opt_db_negative_ttl() \n"
+    "CREATE TABLE IF NOT EXISTS negative_results(                                \n"
+    "                     fingerprint VARCHAR(32),                               \n"
+    "                     get_type INTEGER,                                      \n"
+    "                     provider_name VARCHAR(20),                             \n"
+    "                     timestamp FLOAT,                                       \n"
+    "                     UNIQUE(fingerprint,provider_name)                      \n"
+    ");                                                                          \n"
     "INSERT OR IGNORE INTO db_version VALUES(2);                                 \n"
     "COMMIT;                                                                     \n",
     [SQL_FOREACH] =
@@ -331,6 +350,9 @@ GlyrDatabase * glyr_db_init (const char * root_path)
 
                 /* Now create the Tables via sql */
                 execute (to_return, (char*) sqlcode[SQL_TABLE_DEF]);
+
+                /* Rank providers by what earlier runs saw */
+                db_load_provider_stats (to_return);
             }
             else
             {
@@ -932,9 +954,7 @@ static int select_callback (void * result, int argc, char ** argv, char ** azCol
 
             if (argv[12] != NULL && cache->size > 0)
             {
-                cache->data = g_malloc0 (cache->size + 1);
-                memcpy (cache->data,argv[12],cache->size);
-                cache->data[cache->size] = 0;
+                memcpy (DL_alloc_data (cache,cache->size),argv[12],cache->size);
             }
 
             cache->rating = (argv[13] ? strtol (argv[13],NULL,10) : 0);
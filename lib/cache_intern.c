@@ -21,6 +21,8 @@
 #include "glyr.h"
 #include "cache.h"
 #include "cache_intern.h"
+#include "provstats.h"
+#include "register_plugins.h"
 #include <glib.h>
 
 /////////////////////////////////
@@ -70,3 +72,248 @@ gboolean db_contains (GlyrDatabase * db, GlyrMemCache * cache)
 /////////////////////////////////
 /////////////////////////////////
 
+/* Find the MetaDataSource with this name delivering type */
+static MetaDataSource * find_source (GLYR_GET_TYPE type, const gchar * name)
+{
+    for (GList * elem = r_getSList(); elem; elem = elem->next)
+    {
+        MetaDataSource * src = elem->data;
+        if (src->type == type && g_strcmp0 (src->name,name) == 0)
+        {
+            return src;
+        }
+    }
+    return NULL;
+}
+
+/////////////////////////////////
+
+void db_load_provider_stats (GlyrDatabase * db)
+{
+    if (db == NULL)
+    {
+        return;
+    }
+
+    sqlite3_stmt * stmt = NULL;
+    const gchar * sql = "SELECT get_type,provider_name,samples,success_rate,useful_rate,latency FROM provider_stats;";
+    if (sqlite3_prepare_v2 (db->db_handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        glyr_message (-1,NULL,"db_load_provider_stats: %s\n", sqlite3_errmsg (db->db_handle) );
+        return;
+    }
+
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+        MetaDataSource * src = find_source (sqlite3_column_int (stmt,0), (const gchar *) sqlite3_column_text (stmt,1) );
+        if (src != NULL)
+        {
+            ProviderStats stats;
+            memset (&stats,0,sizeof (stats) );
+            stats.samples = sqlite3_column_int (stmt,2);
+            stats.success_rate = sqlite3_column_double (stmt,3);
+            stats.useful_rate = sqlite3_column_double (stmt,4);
+
+            /* Latencies are stored oldest first */
+            gsize bytes = MIN (sqlite3_column_bytes (stmt,5), (int) sizeof (stats.latency) );
+            const void * latency = sqlite3_column_blob (stmt,5);
+            if (latency != NULL)
+            {
+                memcpy (stats.latency,latency,bytes);
+                stats.latency_count = bytes / sizeof (gfloat);
+                stats.latency_next = stats.latency_count % PROVSTATS_WINDOW;
+            }
+            provstats_set (src,&stats);
+        }
+    }
+    sqlite3_finalize (stmt);
+}
+
+/////////////////////////////////
+
+/* Writes only the providers that changed since the last call */
+void db_save_provider_stats (GlyrDatabase * db)
+{
+    if (db == NULL)
+    {
+        return;
+    }
+
+    sqlite3_stmt * stmt = NULL;
+    const gchar * sql = "INSERT OR REPLACE INTO provider_stats VALUES(?,?,?,?,?,?);";
+    if (sqlite3_prepare_v2 (db->db_handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        glyr_message (-1,NULL,"db_save_provider_stats: %s\n", sqlite3_errmsg (db->db_handle) );
+        return;
+    }
+
+    gboolean in_transaction = FALSE;
+    for (GList * elem = r_getSList(); elem; elem = elem->next)
+    {
+        ProviderStats stats;
+        MetaDataSource * src = elem->data;
+        if (provstats_take_changed (src,&stats) == TRUE && stats.samples > 0)
+        {
+            if (in_transaction == FALSE)
+            {
+                sqlite3_exec (db->db_handle,"BEGIN IMMEDIATE;",NULL,NULL,NULL);
+                in_transaction = TRUE;
+            }
+
+            /* Unroll the ring buffer, oldest first */
+            gfloat latency[PROVSTATS_WINDOW];
+            guint first = (stats.latency_count < PROVSTATS_WINDOW) ? 0 : stats.latency_next;
+            for (guint i = 0; i < stats.latency_count; i++)
+            {
+                latency[i] = stats.latency[ (first + i) % PROVSTATS_WINDOW];
+            }
+
+            sqlite3_bind_int (stmt,1,src->type);
+            sqlite3_bind_text (stmt,2,src->name,-1,SQLITE_STATIC);
+            sqlite3_bind_int (stmt,3,stats.samples);
+            sqlite3_bind_double (stmt,4,stats.success_rate);
+            sqlite3_bind_double (stmt,5,stats.useful_rate);
+            sqlite3_bind_blob (stmt,6,latency,stats.latency_count * sizeof (gfloat),SQLITE_TRANSIENT);
+
+            if (sqlite3_step (stmt) != SQLITE_DONE)
+            {
+                glyr_message (-1,NULL,"db_save_provider_stats: %s\n", sqlite3_errmsg (db->db_handle) );
+            }
+            sqlite3_reset (stmt);
+        }
+    }
+
+    if (in_transaction == TRUE)
+    {
+        sqlite3_exec (db->db_handle,"COMMIT;",NULL,NULL,NULL);
+    }
+    sqlite3_finalize (stmt);
+}
+
+/////////////////////////////////
+/////////////////////////////////
+/////////////////////////////////
+
+/* Case and unicode form don't make another query */
+static void append_fingerprint_field (GString * key, const gchar * value)
+{
+    if (value != NULL)
+    {
+        gchar * normalized = g_utf8_normalize (value,-1,G_NORMALIZE_ALL_COMPOSE);
+        gchar * folded = g_utf8_casefold ( (normalized) ? normalized : value,-1);
+        g_string_append (key,g_strstrip (folded) );
+        g_free (folded);
+        g_free (normalized);
+    }
+    g_string_append_c (key,'\n');
+}
+
+/////////////////////////////////
+
+/* Identifies what is searched for, not how; never NULL.
+ * Options like the number of items or the ttl are left out on purpose,
+ * changing them should not forget what providers are known to miss.
+ */
+static gchar * negative_fingerprint (GlyrQuery * query)
+{
+    GString * key = g_string_new (NULL);
+    g_string_append_printf (key,"%d\n",query->type);
+    append_fingerprint_field (key,query->artist);
+    append_fingerprint_field (key,query->album);
+    append_fingerprint_field (key,query->title);
+    append_fingerprint_field (key,query->from);
+
+    gchar * fingerprint = g_compute_checksum_for_string (G_CHECKSUM_MD5,key->str,key->len);
+    g_string_free (key,TRUE);
+    return fingerprint;
+}
+
+/////////////////////////////////
+
+/* Returns a list of provider names, free with g_free */
+GList * db_lookup_misses (GlyrDatabase * db, GlyrQuery * query)
+{
+    GList * misses = NULL;
+    if (db == NULL || query == NULL)
+    {
+        return NULL;
+    }
+
+    sqlite3_stmt * stmt = NULL;
+    const gchar * sql = "SELECT provider_name FROM negative_results WHERE fingerprint = ? AND get_type = ? AND timestamp > ?;";
+    if (sqlite3_prepare_v2 (db->db_handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        glyr_message (-1,NULL,"db_lookup_misses: %s\n", sqlite3_errmsg (db->db_handle) );
+        return NULL;
+    }
+
+    gchar * fingerprint = negative_fingerprint (query);
+    gdouble now = g_get_real_time() / (gdouble) G_USEC_PER_SEC;
+    sqlite3_bind_text (stmt,1,fingerprint,-1,SQLITE_STATIC);
+    sqlite3_bind_int (stmt,2,query->type);
+    sqlite3_bind_double (stmt,3,now - query->db_negative_ttl);
+
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+        misses = g_list_prepend (misses,g_strdup ( (const gchar *) sqlite3_column_text (stmt,0) ) );
+    }
+
+    sqlite3_finalize (stmt);
+    g_free (fingerprint);
+    return misses;
+}
+
+/////////////////////////////////
+
+/* missed and found are lists of provider names; found ones are forgotten again */
+void db_record_misses (GlyrDatabase * db, GlyrQuery * query, GList * missed, GList * found)
+{
+    if (db == NULL || query == NULL || (missed == NULL && found == NULL) )
+    {
+        return;
+    }
+
+    sqlite3_stmt * insert = NULL, * forget = NULL;
+    const gchar * insert_sql = "INSERT OR REPLACE INTO negative_results VALUES(?,?,?,?);";
+    const gchar * forget_sql = "DELETE FROM negative_results WHERE fingerprint = ? AND provider_name = ?;";
+    if (sqlite3_prepare_v2 (db->db_handle, insert_sql, -1, &insert, NULL) != SQLITE_OK ||
+            sqlite3_prepare_v2 (db->db_handle, forget_sql, -1, &forget, NULL) != SQLITE_OK)
+    {
+        glyr_message (-1,NULL,"db_record_misses: %s\n", sqlite3_errmsg (db->db_handle) );
+        sqlite3_finalize (insert);
+        return;
+    }
+
+    gchar * fingerprint = negative_fingerprint (query);
+    gdouble now = g_get_real_time() / (gdouble) G_USEC_PER_SEC;
+
+    sqlite3_exec (db->db_handle,"BEGIN IMMEDIATE;",NULL,NULL,NULL);
+    for (GList * elem = missed; elem; elem = elem->next)
+    {
+        sqlite3_bind_text (insert,1,fingerprint,-1,SQLITE_STATIC);
+        sqlite3_bind_int (insert,2,query->type);
+        sqlite3_bind_text (insert,3,elem->data,-1,SQLITE_STATIC);
+        sqlite3_bind_double (insert,4,now);
+        if (sqlite3_step (insert) != SQLITE_DONE)
+        {
+            glyr_message (-1,NULL,"db_record_misses: %s\n", sqlite3_errmsg (db->db_handle) );
+        }
+        sqlite3_reset (insert);
+    }
+
+    for (GList * elem = found; elem; elem = elem->next)
+    {
+        sqlite3_bind_text (forget,1,fingerprint,-1,SQLITE_STATIC);
+        sqlite3_bind_text (forget,2,elem->data,-1,SQLITE_STATIC);
+        if (sqlite3_step (forget) != SQLITE_DONE)
+        {
+            glyr_message (-1,NULL,"db_record_misses: %s\n", sqlite3_errmsg (db->db_handle) );
+        }
+        sqlite3_reset (forget);
+    }
+    sqlite3_exec (db->db_handle,"COMMIT;",NULL,NULL,NULL);
+
+    sqlite3_finalize (insert);
+    sqlite3_finalize (forget);
+    g_free (fingerprint);
+}
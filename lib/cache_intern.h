@@ -28,4 +28,12 @@
 /* Check if a file is contained in the db */
 gboolean db_contains (GlyrDatabase * db, GlyrMemCache * cache);
 
+/* Persist the provider statistics gathered by provstats.c */
+void db_load_provider_stats (GlyrDatabase * db);
+void db_save_provider_stats (GlyrDatabase * db);
+
+/* Providers that found nothing for query within its db_negative_ttl */
+GList * db_lookup_misses (GlyrDatabase * db, GlyrQuery * query);
+void db_record_misses (GlyrDatabase * db, GlyrQuery * query, GList * missed, GList * found);
+
 #endif
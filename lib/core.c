@@ -19,8 +19,18 @@
  **************************************************************/
 
 #include <errno.h>
+#include <unistd.h>
 #include <curl/multi.h>
 
+/* Linux gets an epoll driven engine, others fall back to curl_multi_wait() */
+#ifdef __linux__
+#define GLYR_USE_EPOLL 1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include <glib/gstdio.h>
+
 #include "stringlib.h"
 #include "core.h"
 
@@ -33,6 +43,24 @@
 /* Mini blacklist */
 #include "blacklist.h"
 
+/* Shared curl handles */
+#include "netpool.h"
+
+/* Per-host rate limits */
+#include "hostlimit.h"
+
+/* Observed provider performance */
+#include "provstats.h"
+
+/* Single-flight table for download_single() */
+#include "flight.h"
+
+/* Remembered provider responses */
+#include "respcache.h"
+
+/* Timing of each transfer */
+#include "trace.h"
+
 /* Somehow needed to prevent some compiler warning.. */
 #include <glib/gprintf.h>
 
@@ -95,370 +123,948 @@ gboolean size_is_okay (int sZ, int min, int max)
 
 //////////////////////////////////////
 
-/* cache incoming data in a GlyrMemCache
- * libglyr is spending quite some time here
- */
-static size_t DL_buffer (void *puffer, size_t size, size_t nmemb, void * buff_data)
+/* Size of the body as announced by the server, or -1 */
+static gssize DL_content_length (CURL * eh)
 {
-    size_t realsize = size * nmemb;
-    DLBufferContainer * data = (DLBufferContainer *) buff_data;
-    if (data != NULL)
+    gssize length = -1;
+    if (eh != NULL)
     {
-        GlyrMemCache * mem = data->cache;
-        mem->data = realloc (mem->data, mem->size + realsize + 1);
-        if (mem->data)
+#if LIBCURL_VERSION_NUM >= 0x073700
+        curl_off_t announced = -1;
+        if (curl_easy_getinfo (eh, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &announced) == CURLE_OK)
         {
-            memcpy (& (mem->data[mem->size]), puffer, realsize);
-            mem->size += realsize;
-            mem->data[mem->size] = 0;
-
-            GlyrQuery * query = data->query;
-            if (query && GET_ATOMIC_SIGNAL_EXIT (query) )
-            {
-                return 0;
-            }
-
-            /* Test if a endmarker is in this buffer */
-            const gchar * endmarker = data->endmarker;
-            if (endmarker && strstr (mem->data,endmarker) )
-                return 0;
+            length = announced;
         }
-        else
+#else
+        double announced = -1;
+        if (curl_easy_getinfo (eh, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &announced) == CURLE_OK)
         {
-            glyr_message (-1,NULL,"Caching failed: Out of memory.\n");
-            glyr_message (-1,NULL,"Did you perhaps try to load a 4,7GB .iso into your RAM?\n");
+            length = (gssize) announced;
         }
+#endif
     }
-    return realsize;
+    return length;
 }
 
 //////////////////////////////////////
 
-void DL_set_data (GlyrMemCache * cache, const gchar * data, gint len)
+/* Refcounted storage behind GlyrMemCache->data.
+ * Copies of a cache point to the same bytes and only take a reference,
+ * so results can be handed around without duplicating large images.
+ * A shared block is never written to while it has more than one reference;
+ * DL_set_data() lets go of it and installs a buffer of its own instead.
+ */
+typedef struct
 {
-    if (cache != NULL)
-    {
-        g_free (cache->data);
+    gint refs;
 
-        cache->data = (gchar*) data;
-        if (data != NULL)
-        {
-            cache->size = (len >= 0) ? (gsize) len : strlen (data);
-            update_md5sum (cache);
-        }
-        else
-        {
-            cache->size = 0;
-            memset (cache->md5sum,0,16);
-        }
-    }
-}
+    /* Bodies streamed to glyr_opt_download_dir() are mapped from path instead of living in bytes */
+    GMappedFile * mapped;
+    gchar * path;
+
+    /* FALSE: path was created for this item and goes away with the last reference */
+    gboolean keep_file;
+
+    gchar bytes[];
+} DLSharedData;
 
 //////////////////////////////////////
 
-GlyrMemCache * DL_copy (GlyrMemCache * cache)
+static gchar * DL_shared_contents (DLSharedData * block)
 {
-    GlyrMemCache * result = NULL;
-    if (cache != NULL)
-    {
-        result = g_malloc0 (sizeof (GlyrMemCache) );
-        memcpy (result,cache,sizeof (GlyrMemCache) );
-        if (cache->size > 0)
-        {
-            /* Remember NUL for strings */
-            result->data = g_malloc (cache->size + 1);
-            result->data[cache->size] = 0;
-            memcpy (result->data,cache->data,cache->size);
-        }
-        result->dsrc = g_strdup (cache->dsrc);
-        result->prov = g_strdup (cache->prov);
-        result->img_format = g_strdup (cache->img_format);
-        memcpy (result->md5sum,cache->md5sum,16);
-
-        result->next = NULL;
-        result->prev = NULL;
-    }
-    return result;
+    return (block->mapped != NULL) ? g_mapped_file_get_contents (block->mapped) : block->bytes;
 }
 
 //////////////////////////////////////
 
-// cleanup internal buffer if no longer used
-void DL_free (GlyrMemCache *cache)
+/* The block cache->data lives in, or NULL if data is a plain allocation */
+static DLSharedData * DL_shared_block (GlyrMemCache * cache)
 {
-    if (cache)
+    if (cache->shared != NULL && cache->data != NULL && cache->data == DL_shared_contents (cache->shared) )
     {
-        if (cache->size && cache->data)
-        {
-            g_free (cache->data);
-            cache->data = NULL;
-        }
-        if (cache->dsrc)
-        {
-            g_free (cache->dsrc);
-            cache->dsrc = NULL;
-        }
-
-        if (cache->prov)
-        {
-            g_free (cache->prov);
-            cache->prov = NULL;
-        }
-
-        cache->size = 0;
-        cache->type = GLYR_TYPE_UNKNOWN;
-
-        g_free (cache->img_format);
-        g_free (cache);
-        cache = NULL;
+        return cache->shared;
     }
+    return NULL;
 }
 
 //////////////////////////////////////
 
-// Use this to init the internal buffer
-GlyrMemCache* DL_init (void)
+/* A fresh block holds the only reference to its (uninitialized) bytes */
+static DLSharedData * DL_shared_init (DLSharedData * block)
 {
-    GlyrMemCache * cache = g_malloc0 (sizeof (GlyrMemCache) );
-    memset (cache,0,sizeof (GlyrMemCache) );
-
-    cache->type = GLYR_TYPE_UNKNOWN;
-    cache->cached = FALSE;
-    cache->duration = 0;
-    cache->rating = 0;
-    cache->timestamp = 0.0;
-    return cache;
+    block->refs = 1;
+    block->mapped = NULL;
+    block->path = NULL;
+    block->keep_file = TRUE;
+    return block;
 }
 
 //////////////////////////////////////
 
-// Splits http_proxy to libcurl conform represantation
-static gboolean proxy_to_curl (gchar * proxystring, char ** userpwd, char ** server)
+static void DL_release_data (GlyrMemCache * cache)
 {
-    if (proxystring && userpwd && server)
+    DLSharedData * block = DL_shared_block (cache);
+    if (block != NULL)
     {
-        if (proxystring != NULL)
+        if (g_atomic_int_dec_and_test (&block->refs) )
         {
-            gchar * ddot = strchr (proxystring,':');
-            gchar * asgn = strchr (proxystring,'@');
-
-            if (ddot == NULL || asgn < ddot)
+            if (block->mapped != NULL)
             {
-                *server  = g_strdup (proxystring);
-                *userpwd = NULL;
-                return TRUE;
+                g_mapped_file_unref (block->mapped);
             }
-            else
+            if (block->path != NULL && block->keep_file == FALSE)
             {
-                gsize len = strlen (proxystring);
-                char * protocol = strstr (proxystring,"://");
-
-                if (protocol == NULL)
-                {
-                    protocol = (gchar*) proxystring;
-                }
-                else
-                {
-                    protocol += 3;
-                }
-
-                *userpwd = g_strndup (protocol,asgn-protocol);
-                *server  = g_strndup (asgn+1,protocol+len-asgn);
-                return TRUE;
+                g_unlink (block->path);
             }
+            g_free (block->path);
+            g_free (block);
         }
     }
-    return FALSE;
-}
+    else if (cache->size && cache->data)
+    {
+        g_free (cache->data);
+    }
 
+    cache->data = NULL;
+    cache->shared = NULL;
+}
 
 //////////////////////////////////////
 
-struct header_data
+/* Replace cache->data by size zeroed bytes (plus a NUL) that copies can share.
+ * The returned buffer may be written until the cache is copied the first time.
+ */
+gchar * DL_alloc_data (GlyrMemCache * cache, gsize size)
 {
-    gchar * type;
-    gchar * format;
-    gchar * extra;
-};
+    DLSharedData * block = DL_shared_init (g_malloc (sizeof (DLSharedData) + size + 1) );
+    memset (block->bytes,0,size + 1);
+
+    DL_release_data (cache);
+    cache->shared = block;
+    cache->data = block->bytes;
+    cache->size = size;
+    return cache->data;
+}
 
 //////////////////////////////////////
 
-/* Parse header file. Get Contenttype from it and save it in the header_data struct */
-gsize header_cb (void *ptr, gsize size, gsize nmemb, void *userdata)
+/* Keep the file a streamed cache was mapped from, even once the last copy is freed */
+void DL_keep_file (GlyrMemCache * cache)
 {
-    gsize bytes = size * nmemb;
-    if (ptr != NULL && userdata != NULL)
+    DLSharedData * block = (cache != NULL) ? DL_shared_block (cache) : NULL;
+    if (block != NULL && block->path != NULL)
     {
-        /* Transform safely into string */
-        gchar nulbuf[bytes + 1];
-        memcpy (nulbuf,ptr,bytes);
-        nulbuf[bytes] = '\0';
-
-        /* We're only interested in the content type */
-        gchar * cttp  = "Content-Type: ";
-        gsize ctt_len = strlen (cttp);
-        if (ctt_len < bytes && g_ascii_strncasecmp (cttp,nulbuf,ctt_len) == 0)
-        {
-            gchar ** content_type = g_strsplit_set (nulbuf + ctt_len," /;",0);
-            if (content_type != NULL)
-            {
-                gsize set_at = 0;
-                gchar ** elem = content_type;
-                struct header_data * info = userdata;
-
-                /* Set fields..  */
-                while (elem[0] != NULL)
-                {
-                    if (elem[0][0] != '\0')
-                    {
-                        switch (set_at)
-                        {
-                        case 0:
-                            g_free (info->type);
-                            info->type   = g_strdup (elem[0]);
-                            break;
-                        case 1:
-                            g_free (info->format);
-
-                            /*
-                             * Specialcase:
-                             * htbackdrops uses application/octet-stream as format
-                             * for their images. This is annoying, but needs to be
-                             * handled nevertheless. Shame on you, htbackdrops.
-                             * */
-                            if (g_ascii_strncasecmp (elem[0],"octet-stream",12) == 0)
-                            {
-                                g_free (info->type);
-                                info->type   = g_strdup ("image");
-                                info->format = g_strdup ("jpeg");
-                            }
-                            else
-                            {
-                                info->format = g_strdup (elem[0]);
-                            }
-                            break;
-                        case 2:
-                            g_free (info->extra);
-                            info->extra  = g_strdup (elem[0]);
-                            break;
-                        }
-                        set_at++;
-                    }
-                    elem++;
-                }
-                g_strfreev (content_type);
-            }
-        }
+        block->keep_file = TRUE;
     }
-    return bytes;
 }
 
 //////////////////////////////////////
 
-/* empty callback just prevent writing header to stdout */
-gsize nearly_empty_callback (void * p, gsize size, gsize numb, void * pp_Query)
+/* The size limit of this transfer, 0 if unlimited; see glyr_opt_max_bytes() */
+static gint64 DL_buffer_max_bytes (DLBufferContainer * data)
 {
-    GlyrQuery * query = (GlyrQuery *) pp_Query;
-    return (query && GET_ATOMIC_SIGNAL_EXIT (query) ) ? 0 : (size * numb);
+    GlyrQuery * s = data->query;
+    if (s == NULL || s->max_bytes == 0)
+    {
+        return 0;
+    }
+    else if (s->max_bytes > 0)
+    {
+        return s->max_bytes;
+    }
+
+    /* Default: Only images are limited */
+    return (g_strcmp0 (data->content.type,"image") == 0) ? GLYR_DEFAULT_MAX_IMAGE_BYTES : 0;
 }
 
 //////////////////////////////////////
 
-static void DL_setproxy (CURL *eh, gchar * proxystring)
+/* TRUE if a body of size bytes is over the limit; the transfer is to be aborted then */
+static gboolean DL_buffer_exceeds (DLBufferContainer * data, gint64 size)
 {
-    if (proxystring != NULL)
+    gint64 limit = DL_buffer_max_bytes (data);
+    if (limit > 0 && size > limit)
     {
-        gchar * userpwd;
-        gchar * server;
-        proxy_to_curl (proxystring,&userpwd,&server);
-
-        if (server != NULL)
-        {
-            curl_easy_setopt (eh, CURLOPT_PROXY,server);
-            g_free (server);
-        }
-        else
-        {
-            glyr_message (-1,NULL,"Warning: Invalid proxy string.\n");
-        }
-
-        if (userpwd != NULL)
-        {
-            curl_easy_setopt (eh,CURLOPT_PROXYUSERPWD,userpwd);
-            g_free (userpwd);
-        }
+        glyr_message (2,data->query,"glyr: Dropping download larger than %" G_GINT64_FORMAT " bytes\n",limit);
+        data->oversize = TRUE;
+        return TRUE;
     }
+    return FALSE;
 }
 
 //////////////////////////////////////
 
-static struct header_data * retrieve_content_info (gchar * url, gchar * proxystring, gchar * useragent, GlyrQuery * query)
+/* Make room for at least needed bytes in the buffer.
+ * The buffer grows geometrically, so a download costs
+ * O(n) copies and only a few allocations in total.
+ */
+static gboolean DL_buffer_reserve (DLBufferContainer * data, gsize needed)
 {
-    struct header_data * info = NULL;
-    if (url != NULL)
+    if (needed <= data->capacity)
     {
-        CURL * eh = curl_easy_init();
-        CURLcode rc = CURLE_OK;
-
-        info = g_malloc0 (sizeof (struct header_data) );
-        gchar * link_user_agent =  g_strdup_printf ("%s / linkvalidator",useragent);
+        return TRUE;
+    }
 
-        curl_easy_setopt (eh, CURLOPT_TIMEOUT, 10);
-        curl_easy_setopt (eh, CURLOPT_NOSIGNAL, 1L);
-        curl_easy_setopt (eh, CURLOPT_USERAGENT, link_user_agent);
-        curl_easy_setopt (eh, CURLOPT_URL,url);
-        curl_easy_setopt (eh, CURLOPT_FOLLOWLOCATION, TRUE);
-        curl_easy_setopt (eh, CURLOPT_MAXREDIRS, 5L);
-        curl_easy_setopt (eh, CURLOPT_HEADER,TRUE);
-        curl_easy_setopt (eh, CURLOPT_SSL_VERIFYPEER, FALSE);
+    GlyrMemCache * mem = data->cache;
+    gsize new_capacity = MAX (data->capacity * 2, DL_BUFFER_MIN_SIZE);
 
-        /* Dirty hack here: Amazon bitches at me when setting NOBODY to true *
-         * But otherwise large images won't pass with other providers        *
-         * Check domain therefore..
-         */
-        if (strstr (url,"amazon") != NULL)
-        {
-            curl_easy_setopt (eh, CURLOPT_NOBODY,FALSE);
-        }
-        else
+    /* First chunk: allocate the whole body at once, if we know its size */
+    if (mem->size == 0)
+    {
+        gssize announced = DL_content_length (data->handle);
+        if (announced > 0 && announced < DL_BUFFER_MAX_PRESIZE)
         {
-            curl_easy_setopt (eh, CURLOPT_NOBODY,TRUE);
+            new_capacity = MAX (new_capacity, (gsize) announced + 1);
         }
+    }
 
-        curl_easy_setopt (eh, CURLOPT_HEADERFUNCTION, header_cb);
-        curl_easy_setopt (eh, CURLOPT_WRITEFUNCTION, nearly_empty_callback);
-        curl_easy_setopt (eh, CURLOPT_WRITEDATA, query);
-        curl_easy_setopt (eh, CURLOPT_WRITEHEADER, info);
-
-        /* Set proxy, if any */
-        DL_setproxy (eh, proxystring);
+    while (new_capacity < needed)
+    {
+        new_capacity *= 2;
+    }
 
-        /* This seemed to prevent some valid urls from passing. Strange. */
-        //curl_easy_setopt(eh, CURLOPT_FAILONERROR,TRUE);
+    /* The body is born shared, nobody else sees it until the transfer is done */
+    DLSharedData * block = DL_shared_block (mem);
+    DLSharedData * grown = g_try_realloc (block, sizeof (DLSharedData) + new_capacity);
+    if (grown == NULL)
+    {
+        return FALSE;
+    }
 
-        rc = curl_easy_perform (eh);
-        curl_easy_cleanup (eh);
+    if (block == NULL)
+    {
+        DL_shared_init (grown);
+    }
+
+    mem->shared = grown;
+    mem->data = grown->bytes;
+    data->capacity = new_capacity;
+    return TRUE;
+}
 
-        if (rc != CURLE_OK)
+//////////////////////////////////////
+
+/* Stream the body into a temporary file in dir instead of memory, see glyr_opt_download_dir() */
+static gboolean DL_buffer_to_file (DLBufferContainer * data, const gchar * dir)
+{
+    gchar * tmp_path = g_build_filename (dir,".glyr-XXXXXX",NULL);
+    gint fd = g_mkstemp (tmp_path);
+    FILE * file = (fd != -1) ? fdopen (fd,"wb") : NULL;
+    if (file == NULL)
+    {
+        glyr_message (1,data->query,"glyr: Cannot create a file in '%s': %s\n",dir,g_strerror (errno) );
+        if (fd != -1)
         {
-            if (GET_ATOMIC_SIGNAL_EXIT (query) == FALSE)
+            close (fd);
+            g_unlink (tmp_path);
+        }
+        g_free (tmp_path);
+        return FALSE;
+    }
+
+    data->file = file;
+    data->file_tmp = tmp_path;
+    data->file_dir = dir;
+    data->file_md5 = g_checksum_new (G_CHECKSUM_MD5);
+    return TRUE;
+}
+
+//////////////////////////////////////
+
+/* File name of a streamed body: its md5sum, so the same image is only stored once */
+static gchar * DL_buffer_file_name (DLBufferContainer * data)
+{
+    const gchar * extension = data->cache->img_format;
+    for (const gchar * c = extension; c && *c; c++)
+    {
+        if (g_ascii_isalnum (*c) == FALSE)
+        {
+            extension = NULL;
+            break;
+        }
+    }
+
+    gchar * name = g_strdup_printf ("%s.%s",g_checksum_get_string (data->file_md5), (extension && *extension) ? extension : "img");
+    gchar * path = g_build_filename (data->file_dir,name,NULL);
+    g_free (name);
+    return path;
+}
+
+//////////////////////////////////////
+
+/* Rename a complete streamed body into place and map it as cache->data.
+ * Anything else is thrown away, the cache stays empty then.
+ */
+static void DL_buffer_commit_file (DLBufferContainer * data, CURLcode result)
+{
+    GlyrMemCache * mem = data->cache;
+    gboolean complete = (fclose (data->file) == 0 && result == CURLE_OK && mem->size > 0);
+    data->file = NULL;
+
+    GMappedFile * mapped = NULL;
+    gchar * path = NULL;
+    gboolean created = FALSE;
+
+    if (complete)
+    {
+        path = DL_buffer_file_name (data);
+        if (g_file_test (path,G_FILE_TEST_EXISTS) == FALSE)
+        {
+            /* Atomic: readers never see a partial image */
+            created = (g_rename (data->file_tmp,path) == 0);
+        }
+
+        mapped = g_mapped_file_new (path,FALSE,NULL);
+        if (mapped != NULL && g_mapped_file_get_length (mapped) != mem->size)
+        {
+            /* Some other image with the same name; unlikely, but don't hand it out */
+            g_mapped_file_unref (mapped);
+            mapped = NULL;
+        }
+    }
+
+    if (mapped != NULL)
+    {
+        DLSharedData * block = DL_shared_init (g_malloc (sizeof (DLSharedData) ) );
+        block->mapped = mapped;
+        block->path = g_strdup (path);
+        block->keep_file = !created;
+
+        mem->shared = block;
+        mem->data = g_mapped_file_get_contents (mapped);
+        mem->path = g_strdup (path);
+
+        /* Computed while streaming already */
+        gsize digest_len = sizeof (mem->md5sum);
+        g_checksum_get_digest (data->file_md5,mem->md5sum,&digest_len);
+        mem->md5_data = mem->data;
+        mem->md5_size = mem->size;
+    }
+    else
+    {
+        if (created)
+        {
+            g_unlink (path);
+        }
+        mem->size = 0;
+    }
+
+    /* Still there unless it was renamed */
+    g_unlink (data->file_tmp);
+    g_free (path);
+}
+
+//////////////////////////////////////
+
+/* Give back the unused tail once the transfer is done */
+static void DL_buffer_finish (DLBufferContainer * data, CURLcode result)
+{
+    if (data != NULL && data->cache != NULL && data->oversize)
+    {
+        /* Nothing of it is kept, see glyr_opt_max_bytes() */
+        result = CURLE_FILESIZE_EXCEEDED;
+        if (data->file == NULL)
+        {
+            DL_release_data (data->cache);
+            data->cache->size = 0;
+            data->capacity = 0;
+        }
+    }
+
+    if (data != NULL && data->cache != NULL && (data->cache->data != NULL || data->file != NULL) )
+    {
+        GlyrMemCache * mem = data->cache;
+        if (mem->data != NULL && data->capacity > mem->size + 1)
+        {
+            DLSharedData * shrunk = g_try_realloc (mem->shared, sizeof (DLSharedData) + mem->size + 1);
+            if (shrunk != NULL)
+            {
+                mem->shared = shrunk;
+                mem->data = shrunk->bytes;
+                data->capacity = mem->size + 1;
+            }
+        }
+
+        /* Images tell their format in the Content-Type already */
+        if (mem->img_format == NULL && g_strcmp0 (data->content.type,"image") == 0)
+        {
+            chomp_breakline (data->content.format);
+            mem->img_format = g_strdup (data->content.format);
+        }
+
+        if (data->file != NULL)
+        {
+            DL_buffer_commit_file (data,result);
+        }
+    }
+}
+
+//////////////////////////////////////
+
+static void DL_buffer_free (DLBufferContainer * data)
+{
+    if (data != NULL)
+    {
+        g_free (data->content.type);
+        g_free (data->content.format);
+        g_free (data->content.extra);
+        g_free (data->content.etag);
+        g_free (data->content.last_modified);
+        curl_slist_free_all (data->request_headers);
+
+        /* Transfer never finished, drop what was streamed so far */
+        if (data->file != NULL)
+        {
+            fclose (data->file);
+            g_unlink (data->file_tmp);
+        }
+        if (data->file_md5 != NULL)
+        {
+            g_checksum_free (data->file_md5);
+        }
+        g_free (data->file_tmp);
+        g_free (data);
+    }
+}
+
+//////////////////////////////////////
+
+/* Remember a complete response, or swap in the remembered one on 304 */
+/* Returns result, or an error if the server said 304 to something we forgot meanwhile */
+static CURLcode DL_buffer_respcache (DLBufferContainer * data, const gchar * url, CURLcode result)
+{
+    if (data == NULL || data->cache == NULL || result != CURLE_OK || data->file_dir != NULL)
+    {
+        return result;
+    }
+
+    long code = 0;
+    curl_easy_getinfo (data->handle, CURLINFO_RESPONSE_CODE, &code);
+    if (code == 304)
+    {
+        GlyrMemCache * stored = respcache_revalidated (url);
+        if (stored != NULL)
+        {
+            /* Take over the reference to the stored body */
+            GlyrMemCache * mem = data->cache;
+            DL_release_data (mem);
+            mem->data = stored->data;
+            mem->size = stored->size;
+            mem->shared = stored->shared;
+            if (mem->img_format == NULL)
             {
-                glyr_message (1,query,"- DLError: %s [%d]\n",curl_easy_strerror (rc),rc);
+                mem->img_format = stored->img_format;
+                stored->img_format = NULL;
             }
-            g_free (info);
-            info = NULL;
+            stored->data = NULL;
+            stored->shared = NULL;
+            DL_free (stored);
         }
         else
         {
-            /* Remove trailing newlines,carriage returns */
-            chomp_breakline (info->type);
-            chomp_breakline (info->format);
-            chomp_breakline (info->extra);
+            /* Evicted between lookup and answer; the empty 304 body is no result */
+            glyr_message (2,data->query,"glyr: Got 304 for %s, but the cached response is gone\n",url);
+            DL_release_data (data->cache);
+            data->cache->size = 0;
+            result = CURLE_HTTP_RETURNED_ERROR;
+        }
+    }
+    else if (code == 200)
+    {
+        respcache_store (url,data->cache,data->content.etag,data->content.last_modified);
+    }
+    return result;
+}
+
+//////////////////////////////////////
+
+/* Precompute the Horspool shift table for the endmarker.
+ * Shifts are stored in a byte, longer markers just shift less.
+ */
+static void DL_buffer_set_endmarker (DLBufferContainer * data, gchar * endmarker)
+{
+    data->endmarker  = endmarker;
+    data->marker_pos = 0;
+    data->marker_len = (endmarker) ? strlen (endmarker) : 0;
+
+    if (data->marker_len > 0)
+    {
+        gsize last = data->marker_len - 1;
+        memset (data->marker_skip, MIN (data->marker_len,G_MAXUINT8), sizeof (data->marker_skip) );
+        for (gsize i = 0; i < last; i++)
+        {
+            data->marker_skip[ (guchar) endmarker[i]] = MIN (last - i,G_MAXUINT8);
+        }
+    }
+}
+
+//////////////////////////////////////
+
+/* Scan the bytes received since the last call for the endmarker */
+static gboolean DL_buffer_find_endmarker (DLBufferContainer * data)
+{
+    if (data->marker_len == 0)
+    {
+        return FALSE;
+    }
+
+    const guchar * haystack = (const guchar *) data->cache->data;
+    const guchar * needle   = (const guchar *) data->endmarker;
+    gsize size = data->cache->size;
+    gsize last = data->marker_len - 1;
+    gsize pos  = data->marker_pos;
+
+    while (pos + last < size)
+    {
+        guchar tail = haystack[pos + last];
+        if (tail == needle[last] && memcmp (haystack + pos, needle, last) == 0)
+        {
+            return TRUE;
+        }
+        pos += data->marker_skip[tail];
+    }
+
+    /* Remember where to continue with the next chunk */
+    data->marker_pos = pos;
+    return FALSE;
+}
+
+//////////////////////////////////////
+
+/* cache incoming data in a GlyrMemCache
+ * libglyr is spending quite some time here
+ */
+static size_t DL_buffer (void *puffer, size_t size, size_t nmemb, void * buff_data)
+{
+    size_t realsize = size * nmemb;
+    DLBufferContainer * data = (DLBufferContainer *) buff_data;
+    if (data != NULL && DL_buffer_exceeds (data, (gint64) (data->cache->size + realsize) ) )
+    {
+        /* curl hands us decoded bytes; the size was not announced, compressed, or not truthfully */
+        return 0;
+    }
+    else if (data != NULL && data->file != NULL)
+    {
+        /* Straight to disk, only the md5sum is kept up to date */
+        if (fwrite (puffer,1,realsize,data->file) != realsize)
+        {
+            glyr_message (-1,NULL,"Writing '%s' failed: %s\n",data->file_tmp,g_strerror (errno) );
+            return 0;
+        }
+        g_checksum_update (data->file_md5, (const guchar *) puffer,realsize);
+        data->cache->size += realsize;
+
+        GlyrQuery * query = data->query;
+        if (query && GET_ATOMIC_SIGNAL_EXIT (query) )
+        {
+            return 0;
+        }
+    }
+    else if (data != NULL)
+    {
+        GlyrMemCache * mem = data->cache;
+        if (DL_buffer_reserve (data, mem->size + realsize + 1) )
+        {
+            memcpy (& (mem->data[mem->size]), puffer, realsize);
+            mem->size += realsize;
+            mem->data[mem->size] = 0;
+
+            GlyrQuery * query = data->query;
+            if (query && GET_ATOMIC_SIGNAL_EXIT (query) )
+            {
+                return 0;
+            }
+
+            /* Test if a endmarker is in the new part of this buffer */
+            if (DL_buffer_find_endmarker (data) )
+            {
+                data->marker_found = TRUE;
+                return 0;
+            }
+        }
+        else
+        {
+            glyr_message (-1,NULL,"Caching failed: Out of memory.\n");
+            glyr_message (-1,NULL,"Did you perhaps try to load a 4,7GB .iso into your RAM?\n");
+            return 0;
+        }
+    }
+    return realsize;
+}
+
+//////////////////////////////////////
+
+void DL_set_data (GlyrMemCache * cache, const gchar * data, gint len)
+{
+    if (cache != NULL)
+    {
+        DL_release_data (cache);
+
+        /* The data does not come from there anymore */
+        g_free (cache->path);
+        cache->path = NULL;
+
+        cache->data = (gchar*) data;
+        if (data != NULL)
+        {
+            cache->size = (len >= 0) ? (gsize) len : strlen (data);
+            update_md5sum (cache);
+        }
+        else
+        {
+            cache->size = 0;
+            memset (cache->md5sum,0,16);
+        }
+    }
+}
+
+//////////////////////////////////////
+
+GlyrMemCache * DL_copy (GlyrMemCache * cache)
+{
+    GlyrMemCache * result = NULL;
+    if (cache != NULL)
+    {
+        result = g_malloc0 (sizeof (GlyrMemCache) );
+        memcpy (result,cache,sizeof (GlyrMemCache) );
+        result->data = NULL;
+        result->shared = NULL;
+
+        DLSharedData * block = DL_shared_block (cache);
+        if (block != NULL)
+        {
+            /* Same bytes, one more reference */
+            g_atomic_int_inc (&block->refs);
+            result->data = cache->data;
+            result->shared = block;
+        }
+        else if (cache->size > 0 && cache->data != NULL)
+        {
+            /* Plain buffer: copy it once into a block, copies of the copy are free */
+            memcpy (DL_alloc_data (result,cache->size),cache->data,cache->size);
+        }
+        result->dsrc = g_strdup (cache->dsrc);
+        result->prov = g_strdup (cache->prov);
+        result->img_format = g_strdup (cache->img_format);
+        result->path = g_strdup (cache->path);
+        memcpy (result->md5sum,cache->md5sum,16);
+        if (cache->md5_data == cache->data)
+        {
+            /* Same content, the checksum is still good */
+            result->md5_data = result->data;
+        }
+
+        result->next = NULL;
+        result->prev = NULL;
+    }
+    return result;
+}
+
+//////////////////////////////////////
+
+// cleanup internal buffer if no longer used
+void DL_free (GlyrMemCache *cache)
+{
+    if (cache)
+    {
+        DL_release_data (cache);
+        if (cache->dsrc)
+        {
+            g_free (cache->dsrc);
+            cache->dsrc = NULL;
+        }
+
+        if (cache->prov)
+        {
+            g_free (cache->prov);
+            cache->prov = NULL;
+        }
+
+        cache->size = 0;
+        cache->type = GLYR_TYPE_UNKNOWN;
+
+        g_free (cache->img_format);
+        g_free (cache->path);
+        g_free (cache);
+        cache = NULL;
+    }
+}
+
+//////////////////////////////////////
+
+// Use this to init the internal buffer
+GlyrMemCache* DL_init (void)
+{
+    GlyrMemCache * cache = g_malloc0 (sizeof (GlyrMemCache) );
+    memset (cache,0,sizeof (GlyrMemCache) );
+
+    cache->type = GLYR_TYPE_UNKNOWN;
+    cache->cached = FALSE;
+    cache->duration = 0;
+    cache->rating = 0;
+    cache->timestamp = 0.0;
+    return cache;
+}
+
+//////////////////////////////////////
+
+// Splits http_proxy to libcurl conform represantation
+static gboolean proxy_to_curl (gchar * proxystring, char ** userpwd, char ** server)
+{
+    if (proxystring && userpwd && server)
+    {
+        if (proxystring != NULL)
+        {
+            gchar * ddot = strchr (proxystring,':');
+            gchar * asgn = strchr (proxystring,'@');
+
+            if (ddot == NULL || asgn < ddot)
+            {
+                *server  = g_strdup (proxystring);
+                *userpwd = NULL;
+                return TRUE;
+            }
+            else
+            {
+                gsize len = strlen (proxystring);
+                char * protocol = strstr (proxystring,"://");
+
+                if (protocol == NULL)
+                {
+                    protocol = (gchar*) proxystring;
+                }
+                else
+                {
+                    protocol += 3;
+                }
+
+                *userpwd = g_strndup (protocol,asgn-protocol);
+                *server  = g_strndup (asgn+1,protocol+len-asgn);
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+
+
+//////////////////////////////////////
+
+/* Parse header file. Get Contenttype from it and save it in the header_data struct */
+gsize header_cb (void *ptr, gsize size, gsize nmemb, void *userdata)
+{
+    gsize bytes = size * nmemb;
+    if (ptr != NULL && userdata != NULL)
+    {
+        /* Transform safely into string */
+        gchar nulbuf[bytes + 1];
+        memcpy (nulbuf,ptr,bytes);
+        nulbuf[bytes] = '\0';
+
+        /* Validators for the response cache */
+        struct header_data * validators = userdata;
+        if (g_ascii_strncasecmp (nulbuf,"ETag:",5) == 0)
+        {
+            g_free (validators->etag);
+            validators->etag = g_strstrip (g_strdup (nulbuf + 5) );
+        }
+        else if (g_ascii_strncasecmp (nulbuf,"Last-Modified:",14) == 0)
+        {
+            g_free (validators->last_modified);
+            validators->last_modified = g_strstrip (g_strdup (nulbuf + 14) );
+        }
+
+        /* Otherwise we're only interested in the content type */
+        gchar * cttp  = "Content-Type: ";
+        gsize ctt_len = strlen (cttp);
+        if (ctt_len < bytes && g_ascii_strncasecmp (cttp,nulbuf,ctt_len) == 0)
+        {
+            gchar ** content_type = g_strsplit_set (nulbuf + ctt_len," /;",0);
+            if (content_type != NULL)
+            {
+                gsize set_at = 0;
+                gchar ** elem = content_type;
+                struct header_data * info = userdata;
+
+                /* Set fields..  */
+                while (elem[0] != NULL)
+                {
+                    if (elem[0][0] != '\0')
+                    {
+                        switch (set_at)
+                        {
+                        case 0:
+                            g_free (info->type);
+                            info->type   = g_strdup (elem[0]);
+                            break;
+                        case 1:
+                            g_free (info->format);
+
+                            /*
+                             * Specialcase:
+                             * htbackdrops uses application/octet-stream as format
+                             * for their images. This is annoying, but needs to be
+                             * handled nevertheless. Shame on you, htbackdrops.
+                             * */
+                            if (g_ascii_strncasecmp (elem[0],"octet-stream",12) == 0)
+                            {
+                                g_free (info->type);
+                                info->type   = g_strdup ("image");
+                                info->format = g_strdup ("jpeg");
+                            }
+                            else
+                            {
+                                info->format = g_strdup (elem[0]);
+                            }
+                            break;
+                        case 2:
+                            g_free (info->extra);
+                            info->extra  = g_strdup (elem[0]);
+                            break;
+                        }
+                        set_at++;
+                    }
+                    elem++;
+                }
+                g_strfreev (content_type);
+            }
+        }
+    }
+    return bytes;
+}
+
+//////////////////////////////////////
+
+/* empty callback just prevent writing header to stdout */
+gsize nearly_empty_callback (void * p, gsize size, gsize numb, void * pp_Query)
+{
+    GlyrQuery * query = (GlyrQuery *) pp_Query;
+    return (query && GET_ATOMIC_SIGNAL_EXIT (query) ) ? 0 : (size * numb);
+}
+
+//////////////////////////////////////
+
+static void DL_setproxy (CURL *eh, gchar * proxystring)
+{
+    if (proxystring != NULL)
+    {
+        gchar * userpwd;
+        gchar * server;
+        proxy_to_curl (proxystring,&userpwd,&server);
+
+        if (server != NULL)
+        {
+            curl_easy_setopt (eh, CURLOPT_PROXY,server);
+            g_free (server);
+        }
+        else
+        {
+            glyr_message (-1,NULL,"Warning: Invalid proxy string.\n");
+        }
+
+        if (userpwd != NULL)
+        {
+            curl_easy_setopt (eh,CURLOPT_PROXYUSERPWD,userpwd);
+            g_free (userpwd);
+        }
+    }
+}
+
+//////////////////////////////////////
+
+/* Prefer HTTP/2 and wait for a connection to multiplex on, instead of opening another one */
+static void DL_setmultiplex (CURL * eh, GlyrQuery * s)
+{
+#if LIBCURL_VERSION_NUM >= 0x072F00
+    if (s != NULL && s->multiplex)
+    {
+        curl_easy_setopt (eh, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt (eh, CURLOPT_PIPEWAIT, 1L);
+    }
+#endif
+}
+
+//////////////////////////////////////
+
+/* Configure eh to only fetch the headers of url */
+static void probe_setopt (CURL * eh, gchar * url, gchar * useragent, GlyrQuery * query, struct header_data * info)
+{
+    /* 0 would mean no timeout at all */
+    curl_easy_setopt (eh, CURLOPT_TIMEOUT_MS, MAX (query_time_left (query, 10 * 1000), 1L) );
+    curl_easy_setopt (eh, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt (eh, CURLOPT_USERAGENT, useragent);
+    curl_easy_setopt (eh, CURLOPT_URL,url);
+    curl_easy_setopt (eh, CURLOPT_FOLLOWLOCATION, TRUE);
+    curl_easy_setopt (eh, CURLOPT_MAXREDIRS, 5L);
+    curl_easy_setopt (eh, CURLOPT_HEADER,TRUE);
+    curl_easy_setopt (eh, CURLOPT_SSL_VERIFYPEER, FALSE);
+
+    /* Dirty hack here: Amazon bitches at me when setting NOBODY to true *
+     * But otherwise large images won't pass with other providers        *
+     * Check domain therefore..
+     */
+    if (strstr (url,"amazon") != NULL)
+    {
+        curl_easy_setopt (eh, CURLOPT_NOBODY,FALSE);
+    }
+    else
+    {
+        curl_easy_setopt (eh, CURLOPT_NOBODY,TRUE);
+    }
+
+    curl_easy_setopt (eh, CURLOPT_HEADERFUNCTION, header_cb);
+    curl_easy_setopt (eh, CURLOPT_WRITEFUNCTION, nearly_empty_callback);
+    curl_easy_setopt (eh, CURLOPT_WRITEDATA, query);
+    curl_easy_setopt (eh, CURLOPT_WRITEHEADER, info);
+
+    /* Set proxy, if any */
+    DL_setproxy (eh, (gchar*) query->proxy);
+    DL_setmultiplex (eh, query);
+
+    /* This seemed to prevent some valid urls from passing. Strange. */
+    //curl_easy_setopt(eh, CURLOPT_FAILONERROR,TRUE);
+}
+
+//////////////////////////////////////
+
+/* Header callback of downloads: header_cb(), and reject too large bodies before they're sent */
+static gsize DL_buffer_header (void *ptr, gsize size, gsize nmemb, void *userdata)
+{
+    DLBufferContainer * data = userdata;
+    gsize bytes = header_cb (ptr,size,nmemb,&data->content);
+
+    const gchar * line = ptr;
+    if (bytes >= 5 && g_ascii_strncasecmp (line,"HTTP/",5) == 0)
+    {
+        /* Status line of the next response, e.g. after a redirect */
+        data->announced = -1;
+        data->encoded = FALSE;
+    }
+    else if (bytes > 15 && g_ascii_strncasecmp (line,"Content-Length:",15) == 0)
+    {
+        gchar number[32];
+        gsize length = MIN (bytes - 15, sizeof (number) - 1);
+        memcpy (number,line + 15,length);
+        number[length] = '\0';
+        data->announced = g_ascii_strtoll (number,NULL,10);
+    }
+    else if (bytes > 17 && g_ascii_strncasecmp (line,"Content-Encoding:",17) == 0)
+    {
+        gchar * value = g_strstrip (g_strndup (line + 17,bytes - 17) );
+        data->encoded = (value[0] != '\0' && g_ascii_strcasecmp (value,"identity") != 0);
+        g_free (value);
+    }
+    else if (bytes <= 2 && (line[0] == '\r' || line[0] == '\n') )
+    {
+        /* End of the headers, the Content-Type is known now.
+         * A compressed length says nothing about the decoded size, DL_buffer() checks that */
+        if (data->announced > 0 && data->encoded == FALSE && DL_buffer_exceeds (data,data->announced) )
+        {
+            return 0;
         }
-
-        g_free (link_user_agent);
     }
-    return info;
+    return bytes;
 }
 
 //////////////////////////////////////
@@ -466,8 +1072,8 @@ static struct header_data * retrieve_content_info (gchar * url, gchar * proxystr
 // Init an easyhandler with all relevant options
 static DLBufferContainer * DL_setopt (CURL *eh, GlyrMemCache * cache, const char * url, GlyrQuery * s, void * magic_private_ptr, long timeout, gchar * endmarker)
 {
-    // Set options (see 'man curl_easy_setopt')
-    curl_easy_setopt (eh, CURLOPT_TIMEOUT, timeout);
+    // Set options (see 'man curl_easy_setopt'), no transfer outlives the query's deadline
+    curl_easy_setopt (eh, CURLOPT_TIMEOUT_MS, MAX (query_time_left (s, timeout * 1000), 1L) );
     curl_easy_setopt (eh, CURLOPT_NOSIGNAL, 1L);
 
     // last.fm and discogs require an useragent (wokrs without too)
@@ -484,8 +1090,15 @@ static DLBufferContainer * DL_setopt (CURL *eh, GlyrMemCache * cache, const char
     DLBufferContainer * dlbuffer = g_malloc0 (sizeof (DLBufferContainer) );
     curl_easy_setopt (eh, CURLOPT_WRITEDATA, (void *) dlbuffer);
     dlbuffer->cache = cache;
-    dlbuffer->endmarker = endmarker;
     dlbuffer->query = s;
+    DL_buffer_set_endmarker (dlbuffer, endmarker);
+    dlbuffer->handle = eh;
+    dlbuffer->announced = -1;
+
+    // Remember the Content-Type, saves a HEAD request for images;
+    // also turns down bodies that announce to be too large
+    curl_easy_setopt (eh, CURLOPT_HEADERFUNCTION, DL_buffer_header);
+    curl_easy_setopt (eh, CURLOPT_HEADERDATA, (void *) dlbuffer);
 
     // amazon plugin requires redirects
     curl_easy_setopt (eh, CURLOPT_FOLLOWLOCATION, 1L);
@@ -497,6 +1110,9 @@ static DLBufferContainer * DL_setopt (CURL *eh, GlyrMemCache * cache, const char
     // Set proxy to use
     DL_setproxy (eh, (gchar*) (s) ? s->proxy : NULL);
 
+    // Share connections to the same host
+    DL_setmultiplex (eh, s);
+
     // Discogs requires gzip compression
     curl_easy_setopt (eh, CURLOPT_ENCODING,"gzip");
 
@@ -511,6 +1127,28 @@ static DLBufferContainer * DL_setopt (CURL *eh, GlyrMemCache * cache, const char
 
 //////////////////////////////////////
 
+/* See glyr_opt_deadline() */
+gboolean query_deadline_passed (GlyrQuery * s)
+{
+    return (s != NULL && s->deadline_at != 0 && g_get_monotonic_time() >= s->deadline_at);
+}
+
+//////////////////////////////////////
+
+/* max_ms, or less if the query's deadline comes earlier */
+long query_time_left (GlyrQuery * s, long max_ms)
+{
+    if (s == NULL || s->deadline_at == 0)
+    {
+        return max_ms;
+    }
+
+    gint64 remaining = (s->deadline_at - g_get_monotonic_time() ) / 1000;
+    return CLAMP (remaining, 0, max_ms);
+}
+
+//////////////////////////////////////
+
 gboolean continue_search (gint current, GlyrQuery * s)
 {
     gboolean decision = FALSE;
@@ -521,154 +1159,669 @@ gboolean continue_search (gint current, GlyrQuery * s)
          * alternatively we might hit the maximum for one plugin (off by one!)          */
         gint buffering = (s->imagejob) ? s->number / 3 : 0;
 
-        /* If we use caching we should consider getting a lot more items,
-         * since many of the *may* be already in the Database
-         */
-        gint pre_cache = (s->local_db) ? s->number : 0;
-        decision = (current + s->itemctr) < (s->number + buffering + pre_cache) &&
-                   (current < s->plugmax || (s->plugmax == -1) );
+        /* If we use caching we should consider getting a lot more items,
+         * since many of the *may* be already in the Database
+         */
+        gint pre_cache = (s->local_db) ? s->number : 0;
+        decision = (current + s->itemctr) < (s->number + buffering + pre_cache) &&
+                   (current < s->plugmax || (s->plugmax == -1) );
+
+    }
+    return decision;
+}
+
+//////////////////////////////////////
+// Bad data checker mehods:
+//////////////////////////////////////
+
+/* md5sums are keys of hashtables, they're random enough to take the first bytes */
+static guint md5_hash (gconstpointer key)
+{
+    guint hash;
+    memcpy (&hash,key,sizeof (hash) );
+    return hash;
+}
+
+static gboolean md5_equal (gconstpointer a, gconstpointer b)
+{
+    return memcmp (a,b,16) == 0;
+}
+
+//////////////////////////////////////
+
+/* Check for dupes. This does not affect the HEAD of the list, therefore no GList return */
+gsize delete_dupes (GList * result, GlyrQuery * s)
+{
+    if (!result || g_list_length (result) < 1)
+        return 0;
+
+    /* Keeps the first of each checksum, so the head of result always stays */
+    GHashTable * seen = g_hash_table_new (md5_hash,md5_equal);
+    gint double_items = 0;
+
+    GList * elem = result;
+    while (elem != NULL)
+    {
+        GList * next = elem->next;
+        GlyrMemCache * item = elem->data;
+        if (item != NULL)
+        {
+            ensure_md5sum (item);
+            if (g_hash_table_lookup (seen,item->md5sum) != NULL)
+            {
+                DL_free (item);
+                result = g_list_delete_link (result,elem);
+                double_items++;
+            }
+            else
+            {
+                g_hash_table_insert (seen,item->md5sum,item);
+            }
+        }
+        elem = next;
+    }
+
+    g_hash_table_destroy (seen);
+    return double_items;
+}
+
+//////////////////////////////////////
+
+// Download a singe file NOT in parallel
+static GlyrMemCache * fetch_single (const char* url, GlyrQuery * s, const char * end)
+{
+    if (url != NULL && is_blacklisted ( (gchar*) url) == false)
+    {
+        CURL *curl = NULL;
+        CURLcode res = 0;
+
+        /* Served from memory? */
+        GlyrMemCache * dldata = NULL;
+        struct curl_slist * validators = NULL;
+        if (respcache_lookup (url,&dldata,&validators) == RESPCACHE_FRESH)
+        {
+            trace_cache_hit (s,url);
+            dldata->dsrc = g_strdup (url);
+            update_md5sum (dldata);
+            return dldata;
+        }
+
+        /* Init handles */
+        curl = netpool_easy_acquire();
+        dldata = DL_init();
+
+        if (curl != NULL)
+        {
+            /* Configure curl, DL_buffer stops at the 'end' mark */
+            DLBufferContainer * dlbuffer = DL_setopt (curl,dldata,url,s,NULL, (s) ? s->timeout : 5, (gchar*) end);
+            if (validators != NULL)
+            {
+                curl_easy_setopt (curl, CURLOPT_HTTPHEADER, validators);
+                dlbuffer->request_headers = validators;
+            }
+
+            /* Perform transaction in an engine of its own; it waits for the host's turn,
+             * and glyr_signal_exit() can interrupt it */
+            DLEngine * engine = engine_new (s,1);
+            engine_add_handle (engine,curl,url);
+
+            res = CURLE_ABORTED_BY_CALLBACK;
+            while (engine_get_running (engine) != 0 && !(s && (GET_ATOMIC_SIGNAL_EXIT (s) || query_deadline_passed (s) ) ) )
+            {
+                if (engine_wait (engine, query_time_left (s, (s) ? s->timeout * 1000 : 5000) ) == FALSE)
+                {
+                    break;
+                }
+            }
+
+            int queue_msg = 0;
+            CURLMsg * msg = curl_multi_info_read (engine_get_multi (engine), &queue_msg);
+            if (msg != NULL && msg->msg == CURLMSG_DONE)
+            {
+                res = msg->data.result;
+            }
+            trace_transfer (s,curl,url,res);
+
+            engine_remove_handle (engine,curl);
+            engine_free (engine);
+
+            /* Free the pointer buff */
+            DL_buffer_finish (dlbuffer,res);
+            res = DL_buffer_respcache (dlbuffer,url,res);
+            gboolean oversize = dlbuffer->oversize;
+            gboolean at_marker = (res == CURLE_WRITE_ERROR && dlbuffer->marker_found);
+            DL_buffer_free (dlbuffer);
+
+            /* Stopping at the endmarker ends in a write error, but is fine.
+             * Any other write error (a full disk, no memory, being stopped) is not,
+             * a partial file in the download dir is deleted by then already.
+             */
+            if ( (res != CURLE_OK && at_marker == FALSE) || oversize)
+            {
+                glyr_message (3,s,"glyr: E: singledownload: %s [E:%d]\n", curl_easy_strerror (res),res);
+                DL_free (dldata);
+                dldata = NULL;
+            }
+            else
+            {
+                /* Set the source URL */
+                dldata->dsrc = g_strdup (url);
+            }
+
+            netpool_easy_release (curl);
+            update_md5sum (dldata);
+            return dldata;
+        }
+        curl_slist_free_all (validators);
+        DL_free (dldata);
+    }
+    return NULL;
+}
+
+//////////////////////////////////////
+
+/* Concurrent downloads of the same url share one transfer */
+GlyrMemCache * download_single (const char* url, GlyrQuery * s, const char * end)
+{
+    if (url == NULL)
+    {
+        return NULL;
+    }
+
+    gchar * key = flight_url_key (url,end,s);
+    gboolean leader = TRUE;
+    Flight * flight = flight_join (key,&leader);
+    g_free (key);
+
+    if (leader == FALSE)
+    {
+        GlyrMemCache * shared = NULL;
+        GLYR_ERROR error = GLYRE_OK;
+        if (flight_wait (flight,s,&shared,&error) == TRUE || (s && GET_ATOMIC_SIGNAL_EXIT (s) ) || query_deadline_passed (s) )
+        {
+            return shared;
+        }
+    }
+
+    GlyrMemCache * result = fetch_single (url,s,end);
+    if (leader == TRUE && ( (s && GET_ATOMIC_SIGNAL_EXIT (s) ) || (result == NULL && query_deadline_passed (s) ) ) )
+    {
+        /* Others were not stopped and might have more time, they have to try themselves */
+        flight_abort (flight);
+    }
+    else if (leader == TRUE)
+    {
+        flight_land (flight,result,GLYRE_OK);
+    }
+    return result;
+}
+
+//////////////////////////////////////
+// Event driven transfer engine:
+//
+// Instead of rebuilding fd_sets and select()ing on every
+// iteration, curl tells us through CURLMOPT_SOCKETFUNCTION
+// which sockets it cares about, and through CURLMOPT_TIMERFUNCTION
+// when it wants to be called again. On Linux the sockets live
+// in an epoll set, so the cost per wakeup depends only on the
+// number of ready sockets, not on the number of transfers.
+//////////////////////////////////////
+
+/* Max. number of events fetched per epoll_wait() */
+#define ENGINE_MAX_EVENTS 64
+
+struct _DLEngine
+{
+    /* The multihandle all transfers are attached to */
+    CURLM * multi;
+
+    /* Number of transfers curl is still working on */
+    gint running;
+
+    /* Monotonic time (in µs) when curl wants to be called, -1 if never */
+    gint64 timer_deadline;
+
+#ifdef GLYR_USE_EPOLL
+    gint epoll_fd;
+
+    /* Part of the epoll set, engine_interrupt() writes to it */
+    gint wakeup_fd;
+#endif
+
+    /* Transfers held back by hostlimit, in the order they were added */
+    GQueue waiting;
+
+    /* Monotonic time when the next waiting transfer may start, -1 if unknown */
+    gint64 waiting_deadline;
+
+    /* After that many µs in the queue a transfer starts regardless of its host's budget */
+    gint64 max_waiting;
+
+    /* Started transfers counted by hostlimit: CURL * -> url */
+    GHashTable * granted;
+
+    /* Stream bodies into this directory instead of memory, see async_download_to_dir() */
+    const gchar * save_dir;
+
+    GlyrQuery * query;
+};
+
+/* All living engines, so glyr_signal_exit() can wake them */
+static GList * engine_list = NULL;
+static GMutex engine_lock;
+
+/* A transfer that is not allowed to start yet */
+struct engine_waiter
+{
+    CURL * handle;
+    gchar * url;
+
+    /* Monotonic time it was queued */
+    gint64 queued;
+};
+
+//////////////////////////////////////
+
+#ifdef GLYR_USE_EPOLL
+static int engine_socket_cb (CURL * eh, curl_socket_t sock, int what, void * userp, void * socketp)
+{
+    DLEngine * engine = userp;
+    if (what == CURL_POLL_REMOVE)
+    {
+        epoll_ctl (engine->epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+    }
+    else
+    {
+        struct epoll_event ev;
+        memset (&ev,0,sizeof (ev) );
+        ev.data.fd = sock;
+
+        if (what & CURL_POLL_IN)
+            ev.events |= EPOLLIN;
+        if (what & CURL_POLL_OUT)
+            ev.events |= EPOLLOUT;
+
+        /* curl might tell us about a socket more than once */
+        if (epoll_ctl (engine->epoll_fd, EPOLL_CTL_MOD, sock, &ev) == -1 && errno == ENOENT)
+        {
+            epoll_ctl (engine->epoll_fd, EPOLL_CTL_ADD, sock, &ev);
+        }
+    }
+    return 0;
+}
+#endif
+
+//////////////////////////////////////
+
+static int engine_timer_cb (CURLM * multi, long timeout_ms, void * userp)
+{
+    DLEngine * engine = userp;
+    if (timeout_ms < 0)
+    {
+        engine->timer_deadline = -1;
+    }
+    else
+    {
+        engine->timer_deadline = g_get_monotonic_time() + timeout_ms * 1000;
+    }
+    return 0;
+}
+
+//////////////////////////////////////
+
+DLEngine * engine_new (GlyrQuery * s, long max_connects)
+{
+    DLEngine * engine = g_malloc0 (sizeof (DLEngine) );
+    engine->query = s;
+    engine->running = -1;
+    engine->timer_deadline = -1;
+    engine->waiting_deadline = -1;
+    engine->max_waiting = MAX ( (s) ? s->timeout : 5, 1) * G_USEC_PER_SEC;
+    engine->multi = netpool_multi_acquire();
+    engine->granted = g_hash_table_new_full (g_direct_hash,g_direct_equal,NULL,g_free);
+    g_queue_init (&engine->waiting);
+
+    curl_multi_setopt (engine->multi, CURLMOPT_MAXCONNECTS, max_connects);
+
+    /* HTTP/1.1 pipelining is gone from curl, HTTP/2 multiplexing is what's left */
+#if LIBCURL_VERSION_NUM >= 0x072B00
+    curl_multi_setopt (engine->multi, CURLMOPT_PIPELINING, (s && s->multiplex) ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+#endif
+    curl_multi_setopt (engine->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) ( (s) ? s->max_host_connections : 0) );
+#if LIBCURL_VERSION_NUM >= 0x074300
+    curl_multi_setopt (engine->multi, CURLMOPT_MAX_CONCURRENT_STREAMS, (long) ( (s && s->max_host_streams > 0) ? s->max_host_streams : GLYR_DEFAULT_MAX_HOST_STREAMS) );
+#endif
+    curl_multi_setopt (engine->multi, CURLMOPT_TIMERFUNCTION, engine_timer_cb);
+    curl_multi_setopt (engine->multi, CURLMOPT_TIMERDATA, engine);
+
+#ifdef GLYR_USE_EPOLL
+    engine->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+    curl_multi_setopt (engine->multi, CURLMOPT_SOCKETFUNCTION, engine_socket_cb);
+    curl_multi_setopt (engine->multi, CURLMOPT_SOCKETDATA, engine);
+
+    engine->wakeup_fd = eventfd (0,EFD_NONBLOCK | EFD_CLOEXEC);
+    if (engine->epoll_fd != -1 && engine->wakeup_fd != -1)
+    {
+        struct epoll_event ev;
+        memset (&ev,0,sizeof (ev) );
+        ev.events = EPOLLIN;
+        ev.data.fd = engine->wakeup_fd;
+        epoll_ctl (engine->epoll_fd, EPOLL_CTL_ADD, engine->wakeup_fd, &ev);
+    }
+#endif
+
+    g_mutex_lock (&engine_lock);
+    engine_list = g_list_prepend (engine_list,engine);
+    g_mutex_unlock (&engine_lock);
+    return engine;
+}
+
+//////////////////////////////////////
+
+/* Wake up all engines working for s, so they notice glyr_signal_exit() right away */
+void engine_interrupt (GlyrQuery * s)
+{
+    g_mutex_lock (&engine_lock);
+    for (GList * elem = engine_list; elem; elem = elem->next)
+    {
+        DLEngine * engine = elem->data;
+        if (engine->query == s)
+        {
+#ifdef GLYR_USE_EPOLL
+            guint64 one = 1;
+            while (write (engine->wakeup_fd,&one,sizeof (one) ) == -1 && errno == EINTR);
+#elif LIBCURL_VERSION_NUM >= 0x074400
+            curl_multi_wakeup (engine->multi);
+#endif
+        }
+    }
+    g_mutex_unlock (&engine_lock);
+}
+
+//////////////////////////////////////
+
+void engine_free (DLEngine * engine)
+{
+    if (engine != NULL)
+    {
+        g_mutex_lock (&engine_lock);
+        engine_list = g_list_remove (engine_list,engine);
+        g_mutex_unlock (&engine_lock);
+
+        /* Normally empty by now, see engine_remove_handle() */
+        GHashTableIter iter;
+        gpointer url = NULL;
+        g_hash_table_iter_init (&iter,engine->granted);
+        while (g_hash_table_iter_next (&iter,NULL,&url) )
+        {
+            hostlimit_release (url);
+        }
+        g_hash_table_destroy (engine->granted);
+
+        struct engine_waiter * waiter = NULL;
+        while ( (waiter = g_queue_pop_head (&engine->waiting) ) != NULL)
+        {
+            g_free (waiter->url);
+            g_free (waiter);
+        }
+
+        netpool_multi_release (engine->multi);
+#ifdef GLYR_USE_EPOLL
+        if (engine->epoll_fd != -1)
+        {
+            close (engine->epoll_fd);
+        }
+        if (engine->wakeup_fd != -1)
+        {
+            close (engine->wakeup_fd);
+        }
+#endif
+        g_free (engine);
+    }
+}
+
+//////////////////////////////////////
+
+CURLM * engine_get_multi (DLEngine * engine)
+{
+    return (engine) ? engine->multi : NULL;
+}
+
+//////////////////////////////////////
+
+/* Start all waiting transfers whose host has budget left again */
+static void engine_admit (DLEngine * engine)
+{
+    engine->waiting_deadline = -1;
+
+    GList * elem = engine->waiting.head;
+    while (elem != NULL)
+    {
+        GList * next = elem->next;
+        struct engine_waiter * waiter = elem->data;
+
+        gint64 retry_at = -1;
+        HostLimitResult permit = hostlimit_acquire (waiter->url,&retry_at);
+        if (permit == HOSTLIMIT_WAIT && g_get_monotonic_time() - waiter->queued >= engine->max_waiting)
+        {
+            /* Waited as long as a download may take, better impolite than never */
+            glyr_message (2,engine->query,"- %s: host is busy for too long, starting anyway\n",waiter->url);
+            permit = HOSTLIMIT_UNLIMITED;
+        }
+
+        if (permit == HOSTLIMIT_WAIT)
+        {
+            /* Come back when a token is there, or poll for a free slot */
+            if (retry_at == -1)
+            {
+                retry_at = g_get_monotonic_time() + HOSTLIMIT_POLL_INTERVAL * 1000;
+            }
+            retry_at = MIN (retry_at, waiter->queued + engine->max_waiting);
+
+            if (engine->waiting_deadline == -1 || retry_at < engine->waiting_deadline)
+            {
+                engine->waiting_deadline = retry_at;
+            }
+        }
+        else
+        {
+            if (permit == HOSTLIMIT_GRANTED)
+            {
+                g_hash_table_insert (engine->granted,waiter->handle,waiter->url);
+            }
+            else
+            {
+                g_free (waiter->url);
+            }
+
+            /* It counts as running until curl has seen it */
+            curl_multi_add_handle (engine->multi, waiter->handle);
+            engine->running = MAX (engine->running, 0) + 1;
 
+            g_queue_delete_link (&engine->waiting,elem);
+            g_free (waiter);
+        }
+        elem = next;
     }
-    return decision;
 }
 
-//////////////////////////////////////
-// Bad data checker mehods:
 //////////////////////////////////////
 
-/* Check for dupes. This does not affect the HEAD of the list, therefore no GList return */
-gsize delete_dupes (GList * result, GlyrQuery * s)
+/* Attach a transfer to url; it might wait a bit if its host is busy */
+void engine_add_handle (DLEngine * engine, CURL * eh, const gchar * url)
 {
-    if (!result || g_list_length (result) < 1)
-        return 0;
+    struct engine_waiter * waiter = g_malloc0 (sizeof (struct engine_waiter) );
+    waiter->handle = eh;
+    waiter->url = g_strdup (url);
+    waiter->queued = g_get_monotonic_time();
+    g_queue_push_tail (&engine->waiting,waiter);
+    engine_admit (engine);
+}
 
-    /* Build new hashes, the data might have changed */
-    for (GList * elem = result; elem; elem = elem->next)
+//////////////////////////////////////
+
+/* The transfer of eh is over, let the next one to its host start.
+ * Call it before parsing, parsers might want to download from the same host.
+ */
+void engine_release_slot (DLEngine * engine, CURL * eh)
+{
+    gchar * url = g_hash_table_lookup (engine->granted,eh);
+    if (url != NULL)
     {
-        update_md5sum (elem->data);
+        hostlimit_release (url);
+        g_hash_table_remove (engine->granted,eh);
     }
+}
 
-    gint double_items = 0;
-    for (GList * inode = result; inode; inode = inode->next)
-    {
-        GlyrMemCache * lval = inode->data;
+//////////////////////////////////////
 
-        GList * jnode = result;
-        while (jnode != NULL)
+/* Detach a transfer, whether it was started or not */
+void engine_remove_handle (DLEngine * engine, CURL * eh)
+{
+    for (GList * elem = engine->waiting.head; elem; elem = elem->next)
+    {
+        struct engine_waiter * waiter = elem->data;
+        if (waiter->handle == eh)
         {
-            bool is_duplicate  = false;
-            GlyrMemCache * rval = jnode->data;
-
-            if (lval && rval && rval != lval && lval->size == rval->size)
-            {
-                /* Compare via checkums */
-                if (CALC_MD5SUMS == false)
-                {
-                    if (!memcmp (lval->data,rval->data,rval->size) )
-                    {
-                        is_duplicate = true;
-                    }
-                }
-                else
-                {
-                    if (!memcmp (lval->md5sum,rval->md5sum,16) )
-                    {
-                        is_duplicate = true;
-                    }
-                }
+            g_queue_delete_link (&engine->waiting,elem);
+            g_free (waiter->url);
+            g_free (waiter);
+            return;
+        }
+    }
 
-                /* Delete this element.. */
-                if (is_duplicate == true)
-                {
-                    DL_free (rval);
+    curl_multi_remove_handle (engine->multi, eh);
+    engine_release_slot (engine,eh);
+}
 
-                    /* Delete this ref from the list */
-                    GList * to_free = jnode;
-                    jnode = jnode->next;
-                    result = g_list_delete_link (result,to_free);
+//////////////////////////////////////
 
-                    /* Remember him.. */
-                    double_items++;
-                    continue;
-                }
-            }
-            jnode = jnode->next;
-        }
+/* Transfers curl is working on, plus those waiting to be started */
+gint engine_get_running (DLEngine * engine)
+{
+    if (engine == NULL)
+    {
+        return 0;
     }
 
-    return double_items;
+    gint waiting = g_queue_get_length (&engine->waiting);
+    return (waiting > 0) ? MAX (engine->running, 0) + waiting : engine->running;
 }
 
 //////////////////////////////////////
 
-// Download a singe file NOT in parallel
-GlyrMemCache * download_single (const char* url, GlyrQuery * s, const char * end)
+/* Block until curl has something to do, but not longer than max_wait ms,
+ * then let curl do it. Returns FALSE on unrecoverable errors.
+ */
+gboolean engine_wait (DLEngine * engine, long max_wait)
 {
-    if (url != NULL && is_blacklisted ( (gchar*) url) == false)
+    /* Slots might have been freed meanwhile */
+    if (g_queue_is_empty (&engine->waiting) == FALSE)
     {
-        CURL *curl = NULL;
-        CURLcode res = 0;
+        engine_admit (engine);
+    }
 
-        /* Init handles */
-        curl = curl_easy_init();
-        GlyrMemCache * dldata = DL_init();
+    long wait_time = max_wait;
+    if (engine->timer_deadline != -1)
+    {
+        gint64 remaining = (engine->timer_deadline - g_get_monotonic_time() ) / 1000;
+        wait_time = CLAMP (remaining, 0, max_wait);
+    }
 
-        /* DL_buffer needs the 'end' mark.
-         * As I didnt want to introduce a new struct just for this
-         * I save it in->dsrc */
-        if (end != NULL)
-        {
-            dldata->dsrc = g_strdup (end);
-        }
+    if (engine->waiting_deadline != -1)
+    {
+        gint64 remaining = (engine->waiting_deadline - g_get_monotonic_time() ) / 1000;
+        wait_time = CLAMP (remaining, 0, wait_time);
+    }
 
-        if (curl != NULL)
-        {
-            /* Configure curl */
-            DLBufferContainer * dlbuffer = DL_setopt (curl,dldata,url,s,NULL, (s) ? s->timeout : 5, NULL);
+#ifdef GLYR_USE_EPOLL
+    struct epoll_event events[ENGINE_MAX_EVENTS];
+    gint ready = epoll_wait (engine->epoll_fd, events, ENGINE_MAX_EVENTS, wait_time);
+    if (ready == -1 && errno != EINTR)
+    {
+        glyr_message (1,engine->query,"Error: epoll_wait(%ld): %i: %s\n",wait_time,errno,strerror (errno) );
+        return FALSE;
+    }
 
-            /* Perform transaction */
-            res = curl_easy_perform (curl);
+    for (gint i = 0; i < ready; i++)
+    {
+        /* Interrupted; the caller checks why */
+        if (events[i].data.fd == engine->wakeup_fd)
+        {
+            guint64 counter;
+            while (read (engine->wakeup_fd,&counter,sizeof (counter) ) == -1 && errno == EINTR);
+            continue;
+        }
 
-            /* Free the pointer buff */
-            g_free (dlbuffer);
+        int action = 0;
+        if (events[i].events & EPOLLIN)
+            action |= CURL_CSELECT_IN;
+        if (events[i].events & EPOLLOUT)
+            action |= CURL_CSELECT_OUT;
+        if (events[i].events & (EPOLLERR | EPOLLHUP) )
+            action |= CURL_CSELECT_ERR;
 
-            /* Better check again */
-            if (res != CURLE_OK && res != CURLE_WRITE_ERROR)
-            {
-                glyr_message (3,s,"glyr: E: singledownload: %s [E:%d]\n", curl_easy_strerror (res),res);
-                DL_free (dldata);
-                dldata = NULL;
-            }
-            else
-            {
-                /* Set the source URL */
-                if (dldata->dsrc != NULL)
-                {
-                    g_free (dldata->dsrc);
-                }
+        curl_multi_socket_action (engine->multi, events[i].data.fd, action, &engine->running);
+    }
 
-                dldata->dsrc = g_strdup (url);
-            }
+    /* Either nothing happened, or curl's timer expired meanwhile */
+    if (ready <= 0 || (engine->timer_deadline != -1 && engine->timer_deadline <= g_get_monotonic_time() ) )
+    {
+        engine->timer_deadline = -1;
+        curl_multi_socket_action (engine->multi, CURL_SOCKET_TIMEOUT, 0, &engine->running);
+    }
+#else
+#if LIBCURL_VERSION_NUM >= 0x074400
+    /* Sleeps without transfers too, and engine_interrupt() can wake it */
+    if (curl_multi_poll (engine->multi, NULL, 0, wait_time, NULL) != CURLM_OK)
+    {
+        glyr_message (1,engine->query,"Error: curl_multi_poll() failed!\n");
+        return FALSE;
+    }
+#else
+    /* curl_multi_wait() won't sleep without transfers */
+    if (engine->running <= 0 && wait_time > 0)
+    {
+        g_usleep (wait_time * 1000);
+    }
+    else if (curl_multi_wait (engine->multi, NULL, 0, wait_time, NULL) != CURLM_OK)
+    {
+        glyr_message (1,engine->query,"Error: curl_multi_wait() failed!\n");
+        return FALSE;
+    }
+#endif
 
-            curl_easy_cleanup (curl);
-            update_md5sum (dldata);
-            return dldata;
-        }
-        DL_free (dldata);
+    if (curl_multi_perform (engine->multi, &engine->running) != CURLM_OK)
+    {
+        glyr_message (1,engine->query,"Error: curl_multi_perform() failed!\n");
+        return FALSE;
     }
-    return NULL;
+#endif
+    return TRUE;
 }
 
 //////////////////////////////////////
 
 // Init a callback object and a curl_easy_handle
-static GlyrMemCache * init_async_cache (CURLM * cm, cb_object * capo, GlyrQuery *s, long timeout, gchar * endmark)
+static GlyrMemCache * init_async_cache (DLEngine * engine, cb_object * capo, GlyrQuery *s, long timeout, gchar * endmark)
 {
     GlyrMemCache * dlcache = NULL;
     if (capo && capo->url)
     {
+        /* Make sure this is null at start */
+        capo->dlbuffer = NULL;
+
+        /* Maybe we've seen this response a moment ago; streamed files are never remembered */
+        struct curl_slist * validators = NULL;
+        if (engine->save_dir == NULL && respcache_lookup (capo->url,&dlcache,&validators) == RESPCACHE_FRESH)
+        {
+            capo->cache_hit = TRUE;
+            capo->was_buffered = FALSE;
+            return dlcache;
+        }
+
         /* Init handle */
-        CURL *eh = curl_easy_init();
+        CURL *eh = netpool_easy_acquire();
 
         /* Init cache */
         dlcache = DL_init();
@@ -676,14 +1829,21 @@ static GlyrMemCache * init_async_cache (CURLM * cm, cb_object * capo, GlyrQuery
         /* Remind this handle */
         capo->handle = eh;
 
-        /* Make sure this is null at start */
-        capo->dlbuffer = NULL;
-
         /* Configure this handle */
         capo->dlbuffer = DL_setopt (eh, dlcache, capo->url, s, (void*) capo,timeout, endmark);
+        if (engine->save_dir != NULL)
+        {
+            /* Falls back to memory if the directory is not writable */
+            DL_buffer_to_file (capo->dlbuffer,engine->save_dir);
+        }
+        if (validators != NULL)
+        {
+            curl_easy_setopt (eh, CURLOPT_HTTPHEADER, validators);
+            capo->dlbuffer->request_headers = validators;
+        }
 
         /* Add handle to multihandle */
-        curl_multi_add_handle (cm, eh);
+        engine_add_handle (engine, eh, capo->url);
 
         /* This is set to true once DL_buffer is reached */
         capo->was_buffered = FALSE;
@@ -694,36 +1854,145 @@ static GlyrMemCache * init_async_cache (CURLM * cm, cb_object * capo, GlyrQuery
 
 //////////////////////////////////////
 
-static GList * init_async_download (GList * url_list, GList * endmark_list, CURLM * cmHandle, GlyrQuery * s, int abs_timeout)
+static GList * add_async_download (GList * cb_list, const gchar * url, gchar * endmark, DLEngine * engine, GlyrQuery * s, int abs_timeout)
+{
+    if (is_blacklisted ( (gchar*) url) == false)
+    {
+        cb_object * obj = g_malloc0 (sizeof (cb_object) );
+        obj->s = s;
+        obj->url = g_strdup (url);
+        cb_list = g_list_prepend (cb_list,obj);
+        obj->consumed = FALSE;
+        obj->cache = init_async_cache (engine,obj,s,abs_timeout,endmark);
+    }
+    return cb_list;
+}
+
+//////////////////////////////////////
+
+static GList * init_async_download (GList * url_list, GList * endmark_list, DLEngine * engine, GlyrQuery * s, int abs_timeout)
 {
     GList * cb_list = NULL;
     for (GList * elem = url_list; elem; elem = elem->next)
     {
-        if (is_blacklisted ( (gchar*) elem->data) == false)
+        /* Get the endmark from the endmark list */
+        gint endmark_pos = g_list_position (url_list,elem);
+        GList * glist_m  = g_list_nth (endmark_list,endmark_pos);
+        gchar * endmark  = (glist_m==NULL) ? NULL : glist_m->data;
+        cb_list = add_async_download (cb_list, (gchar*) elem->data,endmark,engine,s,abs_timeout);
+    }
+    return cb_list;
+}
+
+//////////////////////////////////////
+
+/* Called by parsers instead of download_single():
+ * url is downloaded in the same multihandle as everything else,
+ * once it's there continuation is called with it instead of the parser.
+ * userptr is passed to continuation and released with destroy afterwards.
+ */
+void async_followup (cb_object * capo, const gchar * url, AsyncFollowupCB continuation, gpointer userptr, GDestroyNotify destroy)
+{
+    if (capo == NULL || url == NULL || continuation == NULL)
+    {
+        if (destroy != NULL && userptr != NULL)
         {
-            cb_object * obj = g_malloc0 (sizeof (cb_object) );
-            obj->s = s;
-            obj->url = g_strdup ( (gchar*) (elem->data) );
-            cb_list = g_list_prepend (cb_list,obj);
-            obj->consumed = FALSE;
+            destroy (userptr);
+        }
+        return;
+    }
+
+    cb_object * next = g_malloc0 (sizeof (cb_object) );
+    next->s = capo->s;
+    next->url = g_strdup (url);
+    next->origin = g_strdup ( (capo->origin) ? capo->origin : capo->url);
+    next->followup = continuation;
+    next->followup_data = userptr;
+    next->followup_destroy = destroy;
+    capo->pending = g_list_prepend (capo->pending,next);
+}
+
+//////////////////////////////////////
+
+/* Scratch space for the parser of capo.
+ * Strings from chunk_copy_value(), chunk_get_search_value() and chunk_printf()
+ * on it are released in one go once the parser returned; anything that ends up
+ * in a returned GlyrMemCache has to be g_strdup'd out of it.
+ */
+GStringChunk * capo_arena (cb_object * capo)
+{
+    if (capo->arena == NULL)
+    {
+        capo->arena = g_string_chunk_new (CB_ARENA_SIZE);
+    }
+    return capo->arena;
+}
+
+//////////////////////////////////////
+
+static void release_arena (cb_object * capo)
+{
+    if (capo->arena != NULL)
+    {
+        g_string_chunk_free (capo->arena);
+        capo->arena = NULL;
+    }
+}
 
-            /* Get the endmark from the endmark list */
-            gint endmark_pos = g_list_position (url_list,elem);
-            GList * glist_m  = g_list_nth (endmark_list,endmark_pos);
-            gchar * endmark  = (glist_m==NULL) ? NULL : glist_m->data;
-            obj->cache = init_async_cache (cmHandle,obj,s,abs_timeout,endmark);
+//////////////////////////////////////
+
+static void free_cb_object_private (cb_object * item)
+{
+    if (item->followup_destroy != NULL && item->followup_data != NULL)
+    {
+        item->followup_destroy (item->followup_data);
+        item->followup_data = NULL;
+    }
+
+    /* Follow-ups that never got started */
+    for (GList * elem = item->pending; elem; elem = elem->next)
+    {
+        free_cb_object_private (elem->data);
+        g_free (elem->data);
+    }
+    g_list_free (item->pending);
+    item->pending = NULL;
+
+    DL_buffer_free (item->dlbuffer);
+    release_arena (item);
+    g_free (item->origin);
+    g_free (item->url);
+}
+
+//////////////////////////////////////
+
+/* Start the follow-ups a parser requested, they're added to cb_list */
+static GList * start_followups (cb_object * capo, DLEngine * engine, GList * cb_list, long abs_timeout)
+{
+    for (GList * elem = capo->pending; elem; elem = elem->next)
+    {
+        cb_object * next = elem->data;
+        if (is_blacklisted (next->url) == false)
+        {
+            next->cache = init_async_cache (engine,next,next->s,abs_timeout,NULL);
+            cb_list = g_list_prepend (cb_list,next);
+        }
+        else
+        {
+            free_cb_object_private (next);
+            g_free (next);
         }
     }
+
+    g_list_free (capo->pending);
+    capo->pending = NULL;
     return cb_list;
 }
 
 //////////////////////////////////////
 
-static void destroy_async_download (GList * cb_list, CURLM * cmHandle, gboolean free_caches)
+static void destroy_async_download (GList * cb_list, DLEngine * engine, gboolean free_caches)
 {
-    /* Free ressources */
-    curl_multi_cleanup (cmHandle);
-
     if (cb_list != NULL)
     {
         for (GList * elem = cb_list; elem; elem = elem->next)
@@ -731,7 +2000,8 @@ static void destroy_async_download (GList * cb_list, CURLM * cmHandle, gboolean
             cb_object * item = elem->data;
             if (item->handle != NULL)
             {
-                curl_easy_cleanup (item->handle);
+                engine_remove_handle (engine,item->handle);
+                netpool_easy_release (item->handle);
             }
 
             /* Also free unbuffered items, that don't appear in the queue,
@@ -744,17 +2014,145 @@ static void destroy_async_download (GList * cb_list, CURLM * cmHandle, gboolean
                 item->cache = NULL;
             }
 
-            g_free (item->dlbuffer);
-            g_free (item->url);
+            free_cb_object_private (item);
         }
         glist_free_full (cb_list,g_free);
     }
+
+    /* Free ressources */
+    engine_free (engine);
+}
+
+//////////////////////////////////////
+
+/* Providers started while others are still downloading, see execute_query() */
+struct provider_feed
+{
+    MetaDataFetcher * fetcher;
+    gint * fired;
+    GHashTable * url_table;
+    GHashTable * answered; /* See struct provider_calls */
+    GList * urls;      /* Prepared urls of the providers started here, freed by execute_query() */
+    gint slots;        /* Transfers kept in flight: parallel, plus one per hedge */
+    gboolean drained;  /* No provider left in rank order */
+
+    gint64 delay;      /* Time (µs) to wait for the first item before hedging, see glyr_opt_hedge() */
+    gint64 fire_at;    /* Monotonic time of the next hedge, -1 if there won't be one */
+    gint hedges_left;
+    gint itemctr;      /* itemctr when the query was started */
+};
+
+/* userptr of call_provider_callback() */
+struct provider_calls
+{
+    GHashTable * url_table;  /* Prepared url -> MetaDataSource */
+    GHashTable * answered;   /* MetaDataSource whose transfers went through -> whether its parser found something */
+};
+
+static long feed_wait_time (struct provider_feed * feed, long max_wait);
+static GList * feed_refill (struct provider_feed * feed, DLEngine * engine, GList * cb_list, GlyrQuery * s, long abs_timeout);
+
+//////////////////////////////////////
+
+/* plugin had its say; once its parser found something it's not a miss anymore, see record_misses() */
+static void mark_answered (GHashTable * answered, MetaDataSource * plugin, gboolean found)
+{
+    if (found == TRUE || g_hash_table_contains (answered,plugin) == FALSE)
+    {
+        g_hash_table_insert (answered,plugin,GINT_TO_POINTER (found) );
+    }
+}
+
+//////////////////////////////////////
+
+/* Statistics of the provider behind a finished transfer.
+ * Done here, failed and empty transfers never reach the parser.
+ */
+static void feed_account_transfer (struct provider_feed * feed, cb_object * capo)
+{
+    MetaDataSource * plugin = (feed) ? g_hash_table_lookup (feed->url_table, (capo->origin) ? capo->origin : capo->url) : NULL;
+    if (plugin == NULL)
+    {
+        return;
+    }
+
+    trace_set_provider (capo->trace,plugin->name);
+    if (capo->cache_hit == FALSE)
+    {
+        /* Cached responses say nothing about the provider */
+        provstats_record_transfer (plugin, capo->result, capo->elapsed * 1000.0);
+    }
+
+    if (capo->result == CURLE_OK && capo->cache == NULL)
+    {
+        /* Empty download - nothing to parse */
+        provstats_record_result (plugin, FALSE);
+        mark_answered (feed->answered,plugin,FALSE);
+    }
+}
+
+//////////////////////////////////////
+
+/* Responses from the response cache that were not handled yet */
+static gboolean pending_cache_hits (GList * cb_list)
+{
+    for (GList * elem = cb_list; elem; elem = elem->next)
+    {
+        cb_object * capo = elem->data;
+        if (capo->cache_hit == TRUE && capo->was_buffered == FALSE)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//////////////////////////////////////
+
+/* The next cb_object that is ready to be viewed, NULL if there's none.
+ * Responses from the response cache come first, they didn't need a transfer.
+ */
+static cb_object * next_finished (CURLM * cmHandle, GList * cb_list, CURLcode * result)
+{
+    for (GList * elem = cb_list; elem; elem = elem->next)
+    {
+        cb_object * capo = elem->data;
+        if (capo->cache_hit == TRUE && capo->was_buffered == FALSE)
+        {
+            *result = CURLE_OK;
+            return capo;
+        }
+    }
+
+    int queue_msg = 0;
+    CURLMsg * msg = NULL;
+    while ( (msg = curl_multi_info_read (cmHandle, &queue_msg) ) != NULL)
+    {
+        if (msg->msg == CURLMSG_DONE)
+        {
+            /* Get the callback object associated with the curl handle
+             * for some odd reason curl requires a char * pointer */
+            cb_object * capo = NULL;
+            curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, ( ( (char**) &capo) ) );
+            if (capo != NULL)
+            {
+                *result = msg->data.result;
+                return capo;
+            }
+        }
+        else
+        {
+            /* Something in the multidownloading gone wrong */
+            glyr_message (1,NULL,"Error: multiDownload-errorcode: %d\n",msg->msg);
+        }
+    }
+    return NULL;
 }
 
 //////////////////////////////////////
 /* ----------------- THE HEART OF GOLD ------------------ */
 //////////////////////////////////////
-GList * async_download (GList * url_list, GList * endmark_list, GlyrQuery * s, long parallel_fac, long timeout_fac, AsyncDLCB asdl_callback, void * userptr, gboolean free_caches)
+static GList * run_async_download (GList * url_list, GList * endmark_list, GlyrQuery * s, long parallel_fac, long timeout_fac, AsyncDLCB asdl_callback, void * userptr, gboolean free_caches, struct provider_feed * feed, const gchar * save_dir)
 {
     /* Storage for result items */
     GList * item_list = NULL;
@@ -765,222 +2163,216 @@ GList * async_download (GList * url_list, GList * endmark_list, GlyrQuery * s, l
         long abs_timeout  = ABS (timeout_fac  * s->timeout);
         long abs_parallel = ABS (parallel_fac * s->parallel);
 
-        /* select() control */
-        int max_fd, queue_msg, running_handles = -1;
-        long wait_time;
-        fd_set ReadFDS, WriteFDS, ErrorFDS;
-
-        /* Curl Multi Handles (~ container for easy handlers) */
-        CURLM   * cmHandle = curl_multi_init();
-        curl_multi_setopt (cmHandle, CURLMOPT_MAXCONNECTS,abs_parallel);
-        curl_multi_setopt (cmHandle, CURLMOPT_PIPELINING, 1L);
+        /* Engine driving the multihandle (~ container for easy handlers) */
+        DLEngine * engine = engine_new (s, abs_parallel);
+        CURLM * cmHandle = engine_get_multi (engine);
+        engine->save_dir = save_dir;
 
         /* Once set to true this will terminate the download */
         gboolean terminate = FALSE;
 
         /* Now create cb_objects */
-        GList * cb_list = init_async_download (url_list,endmark_list,cmHandle,s,abs_timeout);
+        GList * cb_list = init_async_download (url_list,endmark_list,engine,s,abs_timeout);
 
-        while (GET_ATOMIC_SIGNAL_EXIT (s) == FALSE && running_handles != 0 && terminate == FALSE)
+        while (GET_ATOMIC_SIGNAL_EXIT (s) == FALSE &&
+                (engine_get_running (engine) != 0 || pending_cache_hits (cb_list) ) &&
+                terminate == FALSE &&
+                query_deadline_passed (s) == FALSE)
         {
-            CURLMcode merr = CURLM_CALL_MULTI_PERFORM;
-            while (merr == CURLM_CALL_MULTI_PERFORM)
-            {
-                merr = curl_multi_perform (cmHandle, &running_handles);
-            }
-            if (merr != CURLM_OK)
+            /* Sleep till curl has something to do - or its timer fires; remembered responses don't wait */
+            long max_wait = pending_cache_hits (cb_list) ? 0 : feed_wait_time (feed, query_time_left (s, s->timeout * 1000) );
+            if (engine_wait (engine, max_wait) == FALSE)
             {
-                glyr_message (1,s,"Error: curl_multi_perform() failed!");
-                return NULL;
+                break;
             }
 
-            if (running_handles != 0)
-            {
-                /* Set up fds */
-                FD_ZERO (&ReadFDS);
-                FD_ZERO (&WriteFDS);
-                FD_ZERO (&ErrorFDS);
-
-                if (curl_multi_fdset (cmHandle, &ReadFDS, &WriteFDS, &ErrorFDS, &max_fd) ||
-                        curl_multi_timeout (cmHandle, &wait_time) )
-                {
-                    glyr_message (1,s,"Error while selecting stream. Might be a bug.\n");
-                    return NULL;
-                }
-
-                if (wait_time == -1)
-                    wait_time = 100;
-
-                if (wait_time >= s->timeout * 1000)
-                    wait_time = s->timeout * 1000;
+            /* curl did some work. There might be some fresh flesh! - Check. */
+            cb_object * capo = NULL;
+            CURLcode result = CURLE_OK;
+            while (GET_ATOMIC_SIGNAL_EXIT (s) == FALSE &&
+                    terminate == FALSE &&
+                    (capo = next_finished (cmHandle, cb_list, &result) ) != NULL)
+            {
+                /* Easy handle of this particular DL, NULL if it came from the response cache */
+                CURL *easy_handle = capo->handle;
+                capo->result = result;
 
-                /* Nothing happens.. */
-                if (max_fd == -1)
+                /* Download is complete, drop the preallocated tail */
+                if (easy_handle != NULL)
                 {
-                    g_usleep (wait_time * 100);
+                    /* The parser below might download from the same host */
+                    engine_release_slot (engine,easy_handle);
+
+                    DL_buffer_finish (capo->dlbuffer,result);
+                    result = capo->result = DL_buffer_respcache (capo->dlbuffer,capo->url,result);
+                    curl_easy_getinfo (easy_handle, CURLINFO_TOTAL_TIME, &capo->elapsed);
+                    capo->trace = trace_transfer (s,easy_handle,capo->url,result);
                 }
                 else
                 {
-                    struct timeval Tmax;
-                    Tmax.tv_sec  = (wait_time/1000);
-                    Tmax.tv_usec = (wait_time%1000) *1000;
+                    capo->trace = trace_cache_hit (s,capo->url);
+                }
 
-                    /* Now block till something interesting happens with the download */
-                    if (select (max_fd+1, &ReadFDS, &WriteFDS, &ErrorFDS, &Tmax) == -1)
-                    {
-                        glyr_message (1,s,"Error: select(%i <=> %li): %i: %s\n",max_fd+1, wait_time, errno, strerror (errno) );
-                        return NULL;
-                    }
+                /* It's useless if it's empty  */
+                if (capo && capo->cache && capo->cache->data == NULL)
+                {
+                    capo->consumed = TRUE;
+                    DL_free (capo->cache);
+                    capo->cache = NULL;
                 }
-            }
 
+                /* Mark this cb_object as  */
+                capo->was_buffered = TRUE;
 
-            /* select() returned. There might be some fresh flesh! - Check. */
-            CURLMsg * msg;
-            while (GET_ATOMIC_SIGNAL_EXIT (s) == FALSE &&
-                    terminate == FALSE &&
-                    (msg = curl_multi_info_read (cmHandle, &queue_msg) ) )
-            {
-                /* That download is ready to be viewed */
-                if (msg->msg == CURLMSG_DONE)
+                /* Whatever came of it, the provider's statistics should know */
+                feed_account_transfer (feed,capo);
+
+                /* capo contains now the downloaded cache, ready to parse */
+                if (result == CURLE_OK && capo && capo->cache)
                 {
-                    /* Easy handle of this particular DL */
-                    CURL *easy_handle = msg->easy_handle;
+                    /* How many items from the callback will actually be added */
+                    gint to_add = 0;
 
-                    /* Get the callback object associated with the curl handle
-                     * for some odd reason curl requires a char * pointer */
-                    cb_object * capo = NULL;
-                    curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, ( ( (char**) &capo) ) );
+                    /* Stop download after this came in */
+                    bool stop_download = false;
+                    GList * cb_results = NULL;
 
-                    /* It's useless if it's empty  */
-                    if (capo && capo->cache && capo->cache->data == NULL)
+                    /* Set origin */
+                    if (capo->cache->dsrc != NULL)
                     {
-                        capo->consumed = TRUE;
-                        DL_free (capo->cache);
-                        capo->cache = NULL;
+                        g_free (capo->cache->dsrc);
                     }
+                    capo->cache->dsrc = g_strdup (capo->url);
 
-                    /* Mark this cb_object as  */
-                    capo->was_buffered = TRUE;
-
-                    /* capo contains now the downloaded cache, ready to parse */
-                    if (msg->data.result == CURLE_OK && capo && capo->cache)
+                    /* Call it if present */
+                    if (asdl_callback != NULL)
                     {
-                        /* How many items from the callback will actually be added */
-                        gint to_add = 0;
-
-                        /* Stop download after this came in */
-                        bool stop_download = false;
-                        GList * cb_results = NULL;
-
-                        /* Set origin */
-                        if (capo->cache->dsrc != NULL)
+                        /* Add parsed results or nothing if parsed result is empty */
+                        gdouble parse_start = trace_thread_time();
+                        cb_results = asdl_callback (capo,userptr,&stop_download,&to_add);
+                        if (capo->trace != NULL)
                         {
-                            g_free (capo->cache->dsrc);
-                        }
-                        capo->cache->dsrc = g_strdup (capo->url);
-
-                        /* Call it if present */
-                        if (asdl_callback != NULL)
-                        {
-                            /* Add parsed results or nothing if parsed result is empty */
-                            cb_results = asdl_callback (capo,userptr,&stop_download,&to_add);
+                            capo->trace->parse_time = trace_thread_time() - parse_start;
                         }
+                    }
 
-                        if (cb_results != NULL)
+                    if (cb_results != NULL)
+                    {
+                        /* Fill in the source filed (dsrc) if not already done */
+                        for (GList * elem = cb_results; elem; elem = elem->next)
                         {
-                            /* Fill in the source filed (dsrc) if not already done */
-                            for (GList * elem = cb_results; elem; elem = elem->next)
+                            GlyrMemCache * item = elem->data;
+                            if (item && item->dsrc == NULL)
                             {
-                                GlyrMemCache * item = elem->data;
-                                if (item && item->dsrc == NULL)
-                                {
-                                    /* Plugin didn't do any special download */
-                                    item->dsrc = g_strdup (capo->url);
-                                }
-                                item_list = g_list_prepend (item_list,item);
+                                /* Plugin didn't do any special download */
+                                item->dsrc = g_strdup (capo->url);
                             }
-                            g_list_free (cb_results);
-                        }
-                        else if (to_add != 0)
-                        {
-                            /* Add it as raw data */
-                            item_list = g_list_prepend (item_list,capo->cache);
-                        }
-                        else
-                        {
-                            capo->consumed = TRUE;
-                            DL_free (capo->cache);
-                            capo->cache = NULL;
+                            item_list = g_list_prepend (item_list,item);
                         }
-
-                        /* So, shall we stop? */
-                        terminate = stop_download;
-
+                        g_list_free (cb_results);
+                    }
+                    else if (to_add != 0)
+                    {
+                        /* Add it as raw data */
+                        item_list = g_list_prepend (item_list,capo->cache);
                     }
                     else
                     {
-                        /* Something in this download was wrong. Tell us what. */
-                        char * errstring = (char*) curl_easy_strerror (msg->data.result);
-                        glyr_message (3,capo->s,"- glyr: Downloaderror: %s [errno:%d]\n",
-                                      errstring ? errstring : "Unknown Error",
-                                      msg->data.result);
-
-                        glyr_message (3,capo->s,"  On URL: ");
-                        glyr_message (3,capo->s,"%s\n",capo->url);
-
+                        capo->consumed = TRUE;
                         DL_free (capo->cache);
                         capo->cache = NULL;
-                        capo->consumed = TRUE;
                     }
 
-                    /* We're done with this one.. bybebye */
-                    curl_multi_remove_handle (cmHandle,easy_handle);
-                    curl_easy_cleanup (easy_handle);
-                    capo->handle = NULL;
+                    /* So, shall we stop? */
+                    terminate = stop_download;
+
+                    /* Two-stage providers might want more */
+                    if (terminate == FALSE)
+                    {
+                        cb_list = start_followups (capo,engine,cb_list,abs_timeout);
+                    }
+
                 }
                 else
                 {
-                    /* Something in the multidownloading gone wrong */
-                    glyr_message (1,s,"Error: multiDownload-errorcode: %d\n",msg->msg);
+                    /* Something in this download was wrong. Tell us what. */
+                    char * errstring = (char*) curl_easy_strerror (result);
+                    glyr_message (3,capo->s,"- glyr: Downloaderror: %s [errno:%d]\n",
+                                  errstring ? errstring : "Unknown Error",
+                                  result);
+
+                    glyr_message (3,capo->s,"  On URL: ");
+                    glyr_message (3,capo->s,"%s\n",capo->url);
+
+                    DL_free (capo->cache);
+                    capo->cache = NULL;
+                    capo->consumed = TRUE;
+                }
+
+                /* We're done with this one.. bybebye */
+                if (easy_handle != NULL)
+                {
+                    engine_remove_handle (engine,easy_handle);
+                    netpool_easy_release (easy_handle);
+                    capo->handle = NULL;
                 }
             }
+
+            if (feed != NULL && terminate == FALSE)
+            {
+                /* Enough items; whatever is still running lost the race */
+                terminate = (s->itemctr >= s->number);
+
+                /* Otherwise start the next providers in the freed slots */
+                cb_list = feed_refill (feed,engine,cb_list,s,abs_timeout);
+            }
         }
-        destroy_async_download (cb_list,cmHandle,free_caches);
+        destroy_async_download (cb_list,engine,free_caches);
     }
     return item_list;
 }
 
 //////////////////////////////////////
 
-struct wrap_retrieve_pass_data
+GList * async_download (GList * url_list, GList * endmark_list, GlyrQuery * s, long parallel_fac, long timeout_fac, AsyncDLCB asdl_callback, void * userptr, gboolean free_caches)
 {
-    gchar * url;
-    GlyrQuery * query;
-};
+    return run_async_download (url_list,endmark_list,s,parallel_fac,timeout_fac,asdl_callback,userptr,free_caches,NULL,NULL);
+}
+
+//////////////////////////////////////
 
-static void * wrap_retrieve_content (gpointer data)
+/* Same as async_download(), but the bodies are streamed into files in save_dir
+ * and mapped from there; no endmarks. save_dir may be NULL to keep them in memory.
+ */
+GList * async_download_to_dir (GList * url_list, const gchar * save_dir, GlyrQuery * s, long parallel_fac, long timeout_fac, AsyncDLCB asdl_callback, void * userptr, gboolean free_caches)
 {
-    struct header_data * head = NULL;
-    if (data != NULL)
-    {
-        struct wrap_retrieve_pass_data * passed = data;
-        GlyrQuery * query = passed->query;
-        head = retrieve_content_info (passed->url, (gchar*) query->proxy, (gchar*) query->useragent,query);
-        g_free (passed);
-        passed = NULL;
-    }
-    return head;
+    return run_async_download (url_list,NULL,s,parallel_fac,timeout_fac,asdl_callback,userptr,free_caches,NULL,save_dir);
 }
 
 //////////////////////////////////////
 
+/* One HEAD request issued by check_all_types_in_url_list() */
+struct type_probe
+{
+    GlyrMemCache * item;
+    CURL * handle;
+    CURLcode result;
+    gboolean done;
+    struct header_data info;
+};
+
+//////////////////////////////////////
+
+/* Ask for the Content-Type of all urls at once, without downloading them */
 static void check_all_types_in_url_list (GList * cache_list, GlyrQuery * s)
 {
     if (cache_list != NULL)
     {
-        GHashTable * thread_id_table = g_hash_table_new (g_direct_hash,g_direct_equal);
-        GList * thread_list = NULL;
+        gint probe_count = 0;
+        gint queue_msg = 0;
+        struct type_probe * probes = g_malloc0 (g_list_length (cache_list) * sizeof (struct type_probe) );
+        gchar * link_user_agent = g_strdup_printf ("%s / linkvalidator",s->useragent);
+        DLEngine * engine = engine_new (s, g_list_length (cache_list) );
 
         glyr_message (2,s,"#[%02d/%02d] Checking image-types: [",s->itemctr,s->number);
 
@@ -989,58 +2381,81 @@ static void check_all_types_in_url_list (GList * cache_list, GlyrQuery * s)
             GlyrMemCache * item = elem->data;
             if (item != NULL)
             {
-                struct wrap_retrieve_pass_data * passer = g_malloc0 (sizeof (struct wrap_retrieve_pass_data) );
-                passer->url   = item->data;
-                passer->query = s;
+                struct type_probe * probe = &probes[probe_count++];
+                probe->item   = item;
+                probe->handle = netpool_easy_acquire();
+                probe_setopt (probe->handle, item->data, link_user_agent, s, &probe->info);
+                curl_easy_setopt (probe->handle, CURLOPT_PRIVATE, (void *) probe);
+                engine_add_handle (engine, probe->handle, item->data);
+            }
+        }
 
-                GThread * thread = g_thread_new("content_retriever",
-                        (GThreadFunc) wrap_retrieve_content,
-                        passer);
+        while (GET_ATOMIC_SIGNAL_EXIT (s) == FALSE && engine_get_running (engine) != 0 && query_deadline_passed (s) == FALSE)
+        {
+            if (engine_wait (engine, query_time_left (s, s->timeout * 1000) ) == FALSE)
+            {
+                break;
+            }
 
-                if (thread != NULL)
+            CURLMsg * msg;
+            while ( (msg = curl_multi_info_read (engine_get_multi (engine), &queue_msg) ) )
+            {
+                if (msg->msg == CURLMSG_DONE)
                 {
-                    thread_list = g_list_prepend (thread_list,thread);
+                    struct type_probe * probe = NULL;
+                    curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, ( (char**) &probe) );
+                    if (probe != NULL)
+                    {
+                        probe->result = msg->data.result;
+                        probe->done = TRUE;
+                    }
                 }
-                g_hash_table_insert (thread_id_table,thread,item);
             }
         }
 
-        for (GList * thread = thread_list; thread; thread = thread->next)
+        for (gint i = 0; i < probe_count; i++)
         {
             gboolean success = FALSE;
-            struct header_data * info = g_thread_join (thread->data);
-            if (info != NULL)
+            struct type_probe * probe = &probes[i];
+
+            engine_remove_handle (engine, probe->handle);
+            netpool_easy_release (probe->handle);
+
+            if (probe->done && probe->result == CURLE_OK)
             {
-                GlyrMemCache * linked_cache = g_hash_table_lookup (thread_id_table,thread->data);
-                if (linked_cache != NULL)
-                {
-                    if (g_strcmp0 (info->type,"image") == 0)
-                    {
-                        linked_cache->img_format = g_strdup (info->format);
-                        success = TRUE;
-                    }
-                }
-                else
+                /* Remove trailing newlines,carriage returns */
+                chomp_breakline (probe->info.type);
+                chomp_breakline (probe->info.format);
+
+                if (g_strcmp0 (probe->info.type,"image") == 0)
                 {
-                    glyr_message (1,s,"glyr: Uh oh.. empty link in hashtable..\n");
+                    g_free (probe->item->img_format);
+                    probe->item->img_format = g_strdup (probe->info.format);
+                    success = TRUE;
                 }
-                g_free (info->format);
-                g_free (info->type);
-                g_free (info->extra);
-                g_free (info);
             }
+            else if (probe->done && GET_ATOMIC_SIGNAL_EXIT (s) == FALSE)
+            {
+                glyr_message (1,s,"- DLError: %s [%d]\n",curl_easy_strerror (probe->result),probe->result);
+            }
+
+            g_free (probe->info.format);
+            g_free (probe->info.type);
+            g_free (probe->info.extra);
 
             glyr_message (2,s,"%c", (success) ? '.' : '!');
         }
-        g_list_free (thread_list);
-        g_hash_table_destroy (thread_id_table);
+
+        engine_free (engine);
+        g_free (link_user_agent);
+        g_free (probes);
         glyr_message (2,s,"]");
     }
 }
 
 //////////////////////////////////////
 
-static gboolean format_is_allowed (gchar * format, gchar * allowed)
+gboolean format_is_allowed (gchar * format, gchar * allowed)
 {
     /* Let everything pass */
     if (allowed == NULL)
@@ -1110,6 +2525,14 @@ static GList * kick_out_wrong_formats (GList * data_list, GlyrQuery * s)
 {
     GList * new_head = data_list;
 
+    /* The images are downloaded anyway - their format
+     * is taken from the response then, see async_dl_callback()
+     */
+    if (s->download == TRUE)
+    {
+        return new_head;
+    }
+
     /* Parallely check if the format is what we wanted */
     check_all_types_in_url_list (new_head,s);
 
@@ -1138,9 +2561,7 @@ static void do_charset_conversion (MetaDataSource * source, GList * text_list)
                 gchar * conv = convert_charset (utf8_string,"UTF-8",source->encoding,&new_len);
                 if (conv != NULL)
                 {
-                    cache->size = new_len;
-                    g_free (cache->data);
-                    cache->data = conv;
+                    DL_set_data (cache,conv,new_len);
                 }
                 g_free (utf8_string);
             }
@@ -1203,9 +2624,7 @@ static void normalize_utf8 (GList * text_list)
                 if (normalized_utf8 != NULL)
                 {
                     /* Swap cache contents */
-                    g_free (cache->data);
-                    cache->data = normalized_utf8;
-                    cache->size = strlen (normalized_utf8);
+                    DL_set_data (cache,normalized_utf8,-1);
                 }
             }
         }
@@ -1280,15 +2699,27 @@ static GList * call_provider_callback (cb_object * capo, void * userptr, bool *
     if (userptr != NULL)
     {
         /* Get MetaDataSource correlated to this URL */
-        GHashTable * assoc = (GHashTable*) userptr;
-        MetaDataSource * plugin = g_hash_table_lookup (assoc,capo->url);
+        struct provider_calls * calls = userptr;
+        MetaDataSource * plugin = g_hash_table_lookup (calls->url_table, (capo->origin) ? capo->origin : capo->url);
 
         if (plugin != NULL)
         {
             if (capo->s->itemctr < capo->s->number)
             {
-                /* Call the provider's parser */
-                GList * raw_parsed_data = plugin->parser (capo);
+                /* Call the provider's parser, or the continuation of a follow-up */
+                GList * raw_parsed_data = NULL;
+                if (capo->followup != NULL)
+                {
+                    raw_parsed_data = capo->followup (capo,capo->followup_data);
+                }
+                else
+                {
+                    raw_parsed_data = plugin->parser (capo);
+                }
+                release_arena (capo);
+
+                /* Items dropped below (dupes, cached, wrong format) still count as found */
+                gboolean found = (raw_parsed_data != NULL);
 
                 /* Set the default type if not known otherwise */
                 fix_data_types (raw_parsed_data,plugin,capo->s);
@@ -1357,6 +2788,13 @@ static GList * call_provider_callback (cb_object * capo, void * userptr, bool *
                         g_list_free (raw_parsed_data);
                     }
                 }
+
+                /* Two-stage providers are judged by their follow-ups */
+                if (capo->pending == NULL)
+                {
+                    provstats_record_result (plugin, parsed != NULL);
+                    mark_answered (calls->answered,plugin,found);
+                }
             }
         }
         else
@@ -1449,10 +2887,10 @@ static gfloat calc_rating (gfloat qsratio, gint quality, gint speed)
 
 //////////////////////////////////////
 
-static GList * get_queued (GlyrQuery * s, MetaDataFetcher * fetcher, gint * fired)
+static GList * get_queued (GlyrQuery * s, MetaDataFetcher * fetcher, gint * fired, gint count)
 {
     GList * source_list = NULL;
-    for (gint it = 0; it < s->parallel; it++)
+    for (gint it = 0; it < count; it++)
     {
         gint pos = 0;
         gint max_pos = -1;
@@ -1465,7 +2903,12 @@ static GList * get_queued (GlyrQuery * s, MetaDataFetcher * fetcher, gint * fire
             {
                 if (fired[pos] == 0)
                 {
-                    gfloat rating = calc_rating (s->qsratio,src->quality,src->speed);
+                    /* Start with the static guess, adjusted by what we saw so far */
+                    gint quality = src->quality;
+                    gint speed = src->speed;
+                    provstats_adjust_rating (src,s->timeout,&quality,&speed);
+
+                    gfloat rating = calc_rating (s->qsratio,quality,speed);
                     if (rating > max)
                     {
                         max = rating;
@@ -1496,26 +2939,209 @@ static GList * get_queued (GlyrQuery * s, MetaDataFetcher * fetcher, gint * fire
 
 //////////////////////////////////////
 
-gboolean is_in_result_list (GlyrMemCache * cache, GList * result_list)
+/* Was an item with the same content accepted already during this query? */
+gboolean is_in_result_list (GlyrMemCache * cache, GlyrQuery * s)
 {
-    gboolean result = FALSE;
-    if (cache != NULL)
+    if (cache == NULL || s == NULL || s->accepted == NULL)
+    {
+        return FALSE;
+    }
+
+    ensure_md5sum (cache);
+    return g_hash_table_lookup (s->accepted,cache->md5sum) != NULL;
+}
+
+//////////////////////////////////////
+
+/* cache goes into the results, later copies of it are dupes */
+void remember_result (GlyrMemCache * cache, GlyrQuery * s)
+{
+    if (cache != NULL && s != NULL && s->accepted != NULL)
     {
-        for (GList * elem = result_list; elem; elem = elem->next)
+        ensure_md5sum (cache);
+        if (g_hash_table_lookup (s->accepted,cache->md5sum) == NULL)
         {
-            GlyrMemCache * item = elem->data;
-            if (memcmp (cache->md5sum, item->md5sum, 16) == 0)
+            guchar * key = g_memdup (cache->md5sum,16);
+            g_hash_table_insert (s->accepted,key,key);
+        }
+    }
+}
+
+//////////////////////////////////////
+
+/* Ask item for its URL and relate it to item in url_table.
+ * NULL if there is none, if the provider is down,
+ * or if it's an offline provider - *offline is set then.
+ */
+static gchar * get_source_url (GlyrQuery * query, MetaDataSource * item, GHashTable * url_table, gboolean * offline)
+{
+    gchar * prepared = NULL;
+
+    /* get the url of this MetaDataSource */
+    const gchar * lookup_url = item->get_url (query);
+    if (lookup_url != NULL)
+    {
+        if (g_ascii_strncasecmp (lookup_url,OFFLINE_PROVIDER, (sizeof OFFLINE_PROVIDER) - 1) == 0)
+        {
+            /* This providers offers some autogenerated content */
+            *offline = TRUE;
+            return NULL;
+        }
+
+        if (provstats_allow (item) == FALSE)
+        {
+            /* Provider failed too often lately, don't wait for it again */
+            glyr_message (2,query,"- Skipping %s: provider seems to be down\n",item->name);
+        }
+        else
+        {
+            /* make a sane URL out of it */
+            prepared = prepare_url (lookup_url,query,TRUE);
+
+            /* add it to the hash table and relate it to the MetaDataSource */
+            g_hash_table_insert (url_table, (gpointer) prepared, (gpointer) item);
+        }
+
+        /* If the URL was dyn. allocated, we should go and free it */
+        if (item->free_url == TRUE)
+        {
+            g_free ( (gchar*) lookup_url);
+        }
+    }
+    return prepared;
+}
+
+//////////////////////////////////////
+
+static void feed_init (struct provider_feed * feed, GlyrQuery * query, MetaDataFetcher * fetcher, gint * fired, GHashTable * url_table, GList * source_list)
+{
+    memset (feed,0,sizeof (struct provider_feed) );
+    feed->fetcher = fetcher;
+    feed->fired = fired;
+    feed->url_table = url_table;
+    feed->slots = MAX (query->parallel,1);
+    feed->hedges_left = MAX (query->parallel,1);
+    feed->itemctr = query->itemctr;
+    feed->fire_at = -1;
+
+    if (query->hedge <= 0)
+    {
+        return;
+    }
+
+    /* By then the fastest provider of the group usually answered */
+    gdouble delay_ms = -1;
+    for (GList * elem = source_list; elem; elem = elem->next)
+    {
+        ProviderStats stats;
+        if (provstats_get (elem->data,&stats) == TRUE)
+        {
+            gdouble latency = provstats_latency_percentile (&stats,query->hedge);
+            if (latency >= 0 && (delay_ms < 0 || latency < delay_ms) )
             {
-                result = TRUE;
+                delay_ms = latency;
             }
         }
     }
-    return result;
+
+    /* Nothing known yet - give them half of the timeout */
+    if (delay_ms < 0)
+    {
+        delay_ms = query->timeout * 1000.0 / 2;
+    }
+
+    feed->delay = delay_ms * 1000;
+    feed->fire_at = g_get_monotonic_time() + feed->delay;
+}
+
+//////////////////////////////////////
+
+/* Don't sleep past the next hedge */
+static long feed_wait_time (struct provider_feed * feed, long max_wait)
+{
+    if (feed == NULL || feed->fire_at == -1)
+    {
+        return max_wait;
+    }
+
+    gint64 remaining = (feed->fire_at - g_get_monotonic_time() + 999) / 1000;
+    return CLAMP (remaining, 0, max_wait);
+}
+
+//////////////////////////////////////
+
+/* Start the next provider in rank order, if there's any left */
+static GList * feed_start_next (struct provider_feed * feed, DLEngine * engine, GList * cb_list, GlyrQuery * s, long abs_timeout)
+{
+    gchar * url = NULL;
+    MetaDataSource * src = NULL;
+    GList * offline = NULL;
+    GList * next = NULL;
+    while (url == NULL && (next = get_queued (s,feed->fetcher,feed->fired,1) ) != NULL)
+    {
+        gboolean is_offline = FALSE;
+        src = next->data;
+        url = get_source_url (s,src,feed->url_table,&is_offline);
+        if (is_offline == TRUE)
+        {
+            offline = g_list_prepend (offline,src);
+        }
+        g_list_free (next);
+    }
+
+    /* Offline providers don't need a slot, leave them to start_engine() */
+    for (GList * elem = offline; elem; elem = elem->next)
+    {
+        gint pos = g_list_index (feed->fetcher->provider,elem->data);
+        if (pos != -1)
+        {
+            feed->fired[pos]--;
+        }
+    }
+    g_list_free (offline);
+
+    if (url == NULL)
+    {
+        feed->drained = TRUE;
+        return cb_list;
+    }
+
+    glyr_message (2,s,"---- Triggering: %s\n",src->name);
+    feed->urls = g_list_prepend (feed->urls,url);
+    return add_async_download (cb_list,url,src->endmarker,engine,s,abs_timeout);
+}
+
+//////////////////////////////////////
+
+/* Called whenever transfers finished: keep 'slots' transfers in flight */
+static GList * feed_refill (struct provider_feed * feed, DLEngine * engine, GList * cb_list, GlyrQuery * s, long abs_timeout)
+{
+    /* Nothing came in for too long: one more provider may run in parallel */
+    if (feed->fire_at != -1 && g_get_monotonic_time() >= feed->fire_at)
+    {
+        if (s->itemctr > feed->itemctr || feed->hedges_left <= 0 || feed->drained)
+        {
+            feed->fire_at = -1;
+        }
+        else
+        {
+            glyr_message (2,s,"---- Hedging: nothing after %.0f ms\n",feed->delay / 1000.0);
+            feed->slots++;
+            feed->hedges_left--;
+            feed->fire_at = g_get_monotonic_time() + feed->delay;
+        }
+    }
+
+    while (feed->drained == FALSE && s->itemctr < s->number && engine_get_running (engine) < feed->slots)
+    {
+        cb_list = feed_start_next (feed,engine,cb_list,s,abs_timeout);
+    }
+    return cb_list;
 }
 
 //////////////////////////////////////
 
-static void execute_query (GlyrQuery * query, MetaDataFetcher * fetcher, GList * source_list, gboolean * stop_me, GList ** result_list)
+static void execute_query (GlyrQuery * query, MetaDataFetcher * fetcher, GList * source_list, gint * fired, GHashTable * answered, gboolean * stop_me, GList ** result_list)
 {
     GList * url_list = NULL;
     GList * endmarks = NULL;
@@ -1528,37 +3154,31 @@ static void execute_query (GlyrQuery * query, MetaDataFetcher * fetcher, GList *
         MetaDataSource * item = source->data;
         if (item != NULL)
         {
-            /* get the url of this MetaDataSource */
-            const gchar * lookup_url = item->get_url (query);
+            gboolean offline = FALSE;
+            gchar * prepared = get_source_url (query,item,url_table,&offline);
 
             /* Add this to the list */
-            if (lookup_url != NULL)
+            if (prepared != NULL)
             {
-                if (g_ascii_strncasecmp (lookup_url,OFFLINE_PROVIDER, (sizeof OFFLINE_PROVIDER) - 1) != 0)
-                {
-                    /* make a sane URL out of it */
-                    const gchar * prepared = prepare_url (lookup_url,query,TRUE);
-
-                    /* add it to the hash table and relate it to the MetaDataSource */
-                    g_hash_table_insert (url_table, (gpointer) prepared, (gpointer) item);
-                    url_list = g_list_prepend (url_list, (gpointer) prepared);
-                    endmarks = g_list_prepend (endmarks, (gpointer) item->endmarker);
-
-                    /* If the URL was dyn. allocated, we should go and free it */
-                    if (item->free_url == TRUE)
-                    {
-                        g_free ( (gchar*) lookup_url);
-                    }
-                }
-                else
-                {
-                    /* This providers offers some autogenerated content */
-                    offline_provider = g_list_prepend (offline_provider,item);
-                }
+                url_list = g_list_prepend (url_list, (gpointer) prepared);
+                endmarks = g_list_prepend (endmarks, (gpointer) item->endmarker);
+            }
+            else if (offline == TRUE)
+            {
+                offline_provider = g_list_prepend (offline_provider,item);
             }
         }
     }
 
+    /* Once a transfer is done the next ranked provider takes its slot */
+    struct provider_feed feed;
+    feed_init (&feed,query,fetcher,fired,url_table,source_list);
+    feed.answered = answered;
+
+    struct provider_calls calls;
+    calls.url_table = url_table;
+    calls.answered = answered;
+
     GList * sub_result_list = NULL;
     gsize url_list_length = g_list_length (url_list);
     if (url_list_length != 0 || g_list_length (offline_provider) != 0)
@@ -1579,6 +3199,7 @@ static void execute_query (GlyrQuery * query, MetaDataFetcher * fetcher, GList *
                 pseudo_capo.s = query;
 
                 GList * offline_list = source->parser (&pseudo_capo);
+                release_arena (&pseudo_capo);
 
                 if (query->imagejob)
                 {
@@ -1616,14 +3237,16 @@ static void execute_query (GlyrQuery * query, MetaDataFetcher * fetcher, GList *
         /* Now start the downloadmanager - and call the specified callback with the URL table when an item is ready */
         if (proceed == TRUE && url_list_length != 0 && query->itemctr < query->number)
         {
-            raw_parsed = async_download (url_list,
-                                         endmarks,
-                                         query,
-                                         url_list_length / query->timeout  + 1,
-                                         MIN ( (gint) (url_list_length / query->parallel + 3), query->number + 2),
-                                         call_provider_callback,
-                                         url_table,
-                                         TRUE);
+            raw_parsed = run_async_download (url_list,
+                                             endmarks,
+                                             query,
+                                             url_list_length / query->timeout  + 1,
+                                             MIN ( (gint) (url_list_length / query->parallel + 3), query->number + 2),
+                                             call_provider_callback,
+                                             &calls,
+                                             TRUE,
+                                             &feed,
+                                             NULL);
         }
 
         /* Now finalize our retrieved items */
@@ -1662,6 +3285,7 @@ static void execute_query (GlyrQuery * query, MetaDataFetcher * fetcher, GList *
 
     /* Free ressources */
     glist_free_full (url_list,g_free);
+    glist_free_full (feed.urls,g_free);
     g_list_free (endmarks);
     g_list_free (offline_provider);
     g_hash_table_destroy (url_table);
@@ -1673,6 +3297,7 @@ static void execute_query (GlyrQuery * query, MetaDataFetcher * fetcher, GList *
         if (result_cache != NULL)
         {
             *result_list = g_list_prepend (*result_list,result->data);
+            remember_result (result_cache,query);
         }
     }
     g_list_free (sub_result_list);
@@ -1692,25 +3317,89 @@ static void print_trigger (GlyrQuery * query, GList * src_list)
 
 //////////////////////////////////////
 
+/* Providers that recently found nothing for this very query are not asked again */
+static gboolean skip_known_misses (GlyrQuery * query, MetaDataFetcher * fetcher, gint * fired)
+{
+    gboolean skipped = FALSE;
+    if (query->local_db != NULL && query->db_autoread && query->db_negative_ttl > 0)
+    {
+        GList * misses = db_lookup_misses (query->local_db,query);
+        gint pos = 0;
+        for (GList * elem = fetcher->provider; elem; elem = elem->next, ++pos)
+        {
+            MetaDataSource * src = elem->data;
+            if (fired[pos] == 0 && g_list_find_custom (misses,src->name, (GCompareFunc) g_strcmp0) != NULL)
+            {
+                glyr_message (2,query,"---- Skipping %s: found nothing for this query lately\n",src->name);
+                fired[pos]++;
+                skipped = TRUE;
+            }
+        }
+        glist_free_full (misses,g_free);
+    }
+    return skipped;
+}
+
+//////////////////////////////////////
+
+/* Remember which providers had their say, but their parser found nothing */
+static void record_misses (GlyrQuery * query, GHashTable * answered)
+{
+    if (query->local_db == NULL || query->db_autowrite == FALSE || query->db_negative_ttl <= 0)
+    {
+        return;
+    }
+
+    GList * missed = NULL, * found = NULL;
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init (&iter,answered);
+    while (g_hash_table_iter_next (&iter,&key,&value) )
+    {
+        MetaDataSource * src = key;
+        if (GPOINTER_TO_INT (value) == TRUE)
+        {
+            found = g_list_prepend (found,src->name);
+        }
+        else
+        {
+            missed = g_list_prepend (missed,src->name);
+        }
+    }
+
+    db_record_misses (query->local_db,query,missed,found);
+    g_list_free (missed);
+    g_list_free (found);
+}
+
+//////////////////////////////////////
+
 GList * start_engine (GlyrQuery * query, MetaDataFetcher * fetcher, GLYR_ERROR * err)
 {
     gsize list_len = g_list_length (fetcher->provider);
     gint fired[list_len];
     memset (fired,0,list_len * sizeof (gint) );
 
-    gboolean something_was_searched = FALSE;
     gboolean stop_now = FALSE;
 
+    /* Skipped providers count as searched, we know they have nothing */
+    gboolean something_was_searched = skip_known_misses (query,fetcher,fired);
+    GHashTable * answered = g_hash_table_new (g_direct_hash,g_direct_equal);
+
+    /* md5sums of everything in result_list, see is_in_result_list() */
+    query->accepted = g_hash_table_new_full (md5_hash,md5_equal,g_free,NULL);
+
     GList * src_list = NULL, * result_list = NULL;
     while ( (stop_now == FALSE) &&
             (g_list_length (result_list) < (gsize) query->number) &&
-            (src_list = get_queued (query, fetcher, fired) ) != NULL)
+            (query_deadline_passed (query) == FALSE) &&
+            (src_list = get_queued (query, fetcher, fired, query->parallel) ) != NULL)
     {
         /* Print what provider were triggered */
         print_trigger (query,src_list);
 
         /* Send this list of sources to the download manager */
-        execute_query (query,fetcher,src_list, &stop_now, &result_list);
+        execute_query (query,fetcher,src_list,fired,answered, &stop_now, &result_list);
 
         /* Do not report errors */
         something_was_searched = TRUE;
@@ -1722,6 +3411,19 @@ GList * start_engine (GlyrQuery * query, MetaDataFetcher * fetcher, GLYR_ERROR *
         stop_now = (GET_ATOMIC_SIGNAL_EXIT (query) ) ? TRUE : stop_now;
     }
 
+    if (query_deadline_passed (query) == TRUE)
+    {
+        glyr_message (2,query,"---- Deadline reached, returning %d item(s)\n",g_list_length (result_list) );
+    }
+
+    if (GET_ATOMIC_SIGNAL_EXIT (query) == FALSE)
+    {
+        record_misses (query,answered);
+    }
+    g_hash_table_destroy (answered);
+    g_hash_table_destroy (query->accepted);
+    query->accepted = NULL;
+
     if (something_was_searched == FALSE)
     {
         if (err != NULL)
@@ -1751,6 +3453,20 @@ void update_md5sum (GlyrMemCache * c)
         g_checksum_update (checksum, (const guchar*) c->data, c->size);
         g_checksum_get_digest (checksum, c->md5sum, &bufsize);
         g_checksum_free (checksum);
+
+        c->md5_data = c->data;
+        c->md5_size = c->size;
+    }
+}
+
+//////////////////////////////////////
+
+/* Like update_md5sum(), but only if data was replaced or resized since */
+void ensure_md5sum (GlyrMemCache * c)
+{
+    if (c != NULL && (c->md5_data != c->data || c->md5_size != c->size) )
+    {
+        update_md5sum (c);
     }
 }
 
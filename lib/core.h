@@ -41,12 +41,6 @@
 
 #define G_LOG_DOMAIN "Glyr"
 
-/* libglyr uses checksums to filter double items
- * Also you can use those as easy comparasion method
- * There is no valid reason to diasable this actually
- */
-#define CALC_MD5SUMS true
-
 /* Returned by get_url() in case of offline provider */
 #define OFFLINE_PROVIDER "autogenerated_content"
 
@@ -68,6 +62,27 @@ int glyr_message (int v, GlyrQuery * s, const char * fmt, ...);
 
 /*------------------------------------------------------*/
 
+/* Block size of the parser arena, see capo_arena() */
+#define CB_ARENA_SIZE (4 * 1024)
+
+/* Smallest allocation DL_buffer() does, grows by doubling afterwards */
+#define DL_BUFFER_MIN_SIZE (16 * 1024)
+
+/* Never trust a Content-Length beyond this when presizing */
+#define DL_BUFFER_MAX_PRESIZE (32 * 1024 * 1024)
+
+/* Content-Type of a response, split into its parts */
+struct header_data
+{
+    gchar * type;
+    gchar * format;
+    gchar * extra;
+
+    /* Validators for the response cache */
+    gchar * etag;
+    gchar * last_modified;
+};
+
 /* Used to pass arguments to DL_buffer() */
 typedef struct
 {
@@ -75,10 +90,55 @@ typedef struct
     GlyrQuery * query;
     char * endmarker;
 
+    /* Bytes allocated for cache->data, cache->size is the used part */
+    gsize capacity;
+
+    /* The transfer this buffer belongs to, used to read Content-Length */
+    CURL * handle;
+
+    /* Streaming endmarker search (Boyer-Moore-Horspool):
+     * Matches can't start before marker_pos, so every chunk
+     * is only scanned once, plus strlen(endmarker)-1 bytes overlap.
+     */
+    gsize marker_len;
+    gsize marker_pos;
+    guchar marker_skip[256];
+
+    /* The endmarker was seen and the transfer stopped on purpose */
+    gboolean marker_found;
+
+    /* Filled by the header callback, used to tell the image format */
+    struct header_data content;
+
+    /* Extra request headers, freed with the buffer */
+    struct curl_slist * request_headers;
+
+    /* Content-Length of the current response, -1 if not announced */
+    gint64 announced;
+
+    /* Current response has a Content-Encoding: announced is the compressed size then */
+    gboolean encoded;
+
+    /* Went over glyr_opt_max_bytes(); the transfer was aborted and nothing is kept */
+    gboolean oversize;
+
+    /* Set while streaming into a temporary file in file_dir instead of cache->data */
+    FILE * file;
+    gchar * file_tmp;
+    const gchar * file_dir;
+    GChecksum * file_md5;
+
 } DLBufferContainer;
 
 /*------------------------------------------------------*/
 
+struct cb_object;
+
+/* Second stage of a two-stage provider, see async_followup() */
+typedef GList * (*AsyncFollowupCB) (struct cb_object * capo, gpointer userptr);
+
+/*------------------------------------------------------*/
+
 // Internal calback object, used for cover, lyrics and other
 // This is only used inside the core and the plugins
 // Other parts of the program shall not use this struct
@@ -107,6 +167,31 @@ typedef struct cb_object
     // DLBuffer data
     DLBufferContainer * dlbuffer;
 
+    // Set on follow-up downloads: called instead of the
+    // provider's parser once this url has been downloaded
+    AsyncFollowupCB followup;
+    gpointer followup_data;
+    GDestroyNotify followup_destroy;
+
+    // url of the first stage, used to find the provider again
+    char * origin;
+
+    // Follow-ups scheduled while parsing this object
+    GList * pending;
+
+    // Outcome of the transfer and how long it took (in seconds)
+    CURLcode result;
+    gdouble elapsed;
+
+    // Served from the response cache, there's no transfer
+    gboolean cache_hit;
+
+    // Timing of this transfer, owned by the query; NULL without glyr_opt_trace()
+    GlyrTransferTrace * trace;
+
+    // Scratch strings of the parser, see capo_arena()
+    GStringChunk * arena;
+
 } cb_object;
 
 /*------------------------------------------------------*/
@@ -171,8 +256,28 @@ typedef struct MetaDataSource
 
 /*------------------------------------------------------*/
 
+/* Opaque event driven transfer engine, see core.c */
+typedef struct _DLEngine DLEngine;
+
+DLEngine * engine_new (GlyrQuery * s, long max_connects);
+void engine_free (DLEngine * engine);
+gboolean engine_wait (DLEngine * engine, long max_wait);
+void engine_interrupt (GlyrQuery * s);
+CURLM * engine_get_multi (DLEngine * engine);
+void engine_add_handle (DLEngine * engine, CURL * eh, const gchar * url);
+void engine_release_slot (DLEngine * engine, CURL * eh);
+void engine_remove_handle (DLEngine * engine, CURL * eh);
+gint engine_get_running (DLEngine * engine);
+
+/*------------------------------------------------------*/
+
+/* Called for each finished download. Failed ones are reported too,
+ * with capo->cache set to NULL and capo->result telling what went wrong */
 typedef GList* (*AsyncDLCB) (cb_object*,void *,bool*,gint*);
 GList * async_download (GList * url_list, GList * endmark_list, GlyrQuery * s, long parallel_fac, long timeout_fac, AsyncDLCB callback, void * userptr, gboolean free_caches);
+GList * async_download_to_dir (GList * url_list, const gchar * save_dir, GlyrQuery * s, long parallel_fac, long timeout_fac, AsyncDLCB callback, void * userptr, gboolean free_caches);
+GStringChunk * capo_arena (cb_object * capo);
+void async_followup (cb_object * capo, const gchar * url, AsyncFollowupCB continuation, gpointer userptr, GDestroyNotify destroy);
 GList * start_engine (GlyrQuery * query, MetaDataFetcher * fetcher, GLYR_ERROR * err);
 GlyrMemCache * download_single (const char* url, GlyrQuery * s, const char * end);
 
@@ -182,17 +287,24 @@ GlyrMemCache * DL_init (void);
 GlyrMemCache * DL_copy (GlyrMemCache * cache);
 void DL_free (GlyrMemCache *cache);
 void DL_set_data (GlyrMemCache * cache, const gchar * data, gint len);
+gchar * DL_alloc_data (GlyrMemCache * cache, gsize size);
+void DL_keep_file (GlyrMemCache * cache);
 
 /*------------------------------------------------------*/
 
 void update_md5sum (GlyrMemCache * c);
+void ensure_md5sum (GlyrMemCache * c);
 void glist_free_full (GList * List, void (* free_func) (void * ptr) );
 
 /*------------------------------------------------------*/
 
 gboolean size_is_okay (int sZ, int min, int max);
-gboolean is_in_result_list (GlyrMemCache * cache, GList * result_list);
+gboolean is_in_result_list (GlyrMemCache * cache, GlyrQuery * s);
+void remember_result (GlyrMemCache * cache, GlyrQuery * s);
 gboolean provider_is_enabled (GlyrQuery * q, MetaDataSource * f);
 gboolean continue_search (gint current, GlyrQuery * s);
+gboolean query_deadline_passed (GlyrQuery * s);
+long query_time_left (GlyrQuery * s, long max_ms);
+gboolean format_is_allowed (gchar * format, gchar * allowed);
 
 #endif
@@ -0,0 +1,307 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+/* Single-flight table.
+ *
+ * When the same query (or the same URL) is asked for by several threads
+ * at once, only the first one - the leader - does the work. The others
+ * join its flight, sleep until it landed and get copies of its results.
+ * A flight is removed from the table as soon as it lands, so later
+ * requests start a fresh one; this is not a cache.
+ */
+#include "flight.h"
+
+/////////////////////////////////
+
+struct _Flight
+{
+    gchar * key;
+    gint refs;          /* Leader plus waiting duplicates     */
+    gboolean landed;    /* Leader is done                     */
+    gboolean aborted;   /* Leader gave up, duplicates go alone */
+    GList * items;      /* Copies of the leader's results     */
+    GLYR_ERROR error;
+};
+
+/////////////////////////////////
+
+/* key -> Flight *, protected by flight_lock; flight_cond is signalled on landing */
+static GHashTable * flight_table = NULL;
+static GMutex flight_lock;
+static GCond flight_cond;
+
+/////////////////////////////////
+
+void flight_init (void)
+{
+    g_mutex_lock (&flight_lock);
+    if (flight_table == NULL)
+    {
+        flight_table = g_hash_table_new (g_str_hash,g_str_equal);
+    }
+    g_mutex_unlock (&flight_lock);
+}
+
+/////////////////////////////////
+
+void flight_destroy (void)
+{
+    g_mutex_lock (&flight_lock);
+    if (flight_table != NULL)
+    {
+        g_hash_table_destroy (flight_table);
+        flight_table = NULL;
+    }
+    g_mutex_unlock (&flight_lock);
+}
+
+/////////////////////////////////
+
+/* Needs flight_lock */
+static void flight_unref (Flight * flight)
+{
+    if (--flight->refs == 0)
+    {
+        glist_free_full (flight->items, (void (*) (void *) ) DL_free);
+        g_free (flight->key);
+        g_free (flight);
+    }
+}
+
+/////////////////////////////////
+
+static void append_normalized (GString * key, const gchar * value)
+{
+    if (value != NULL)
+    {
+        gchar * normalized = g_utf8_normalize (value,-1,G_NORMALIZE_ALL_COMPOSE);
+        gchar * folded = g_utf8_casefold ( (normalized) ? normalized : value,-1);
+        g_string_append (key,g_strstrip (folded) );
+        g_free (folded);
+        g_free (normalized);
+    }
+    g_string_append_c (key,'\n');
+}
+
+/////////////////////////////////
+
+/* Canonical fingerprint of everything that changes the result of query,
+ * used only to find identical queries running at the same time. NULL if the query must not be shared: a download callback
+ * has to see every item of its own query, and may stop it.
+ */
+gchar * flight_query_key (GlyrQuery * query)
+{
+    if (query->callback.download != NULL)
+    {
+        return NULL;
+    }
+
+    GString * key = g_string_new ("query\n");
+    g_string_append_printf (key,"%d\n%d\n%d\n%lu\n%d\n%d\n%d\n%d\n%ld\n%d\n%f\n%d\n%d\n%d\n%d\n",
+                            query->type,query->number,query->plugmax,
+                            (unsigned long) query->fuzzyness,
+                            query->img_min_size,query->img_max_size,
+                            query->download,query->force_utf8,query->max_bytes,
+                            query->lang_aware_only,query->qsratio,query->normalization,
+                            query->db_autoread,query->timeout,query->redirects);
+
+    /* Another database, or another negative cache, might know other things */
+    if (query->local_db != NULL && query->db_autoread)
+    {
+        g_string_append_printf (key,"%s\n%d\n",query->local_db->root_path,query->db_negative_ttl);
+    }
+
+    append_normalized (key,query->artist);
+    append_normalized (key,query->album);
+    append_normalized (key,query->title);
+    append_normalized (key,query->from);
+    append_normalized (key,query->lang);
+    append_normalized (key,query->allowed_formats);
+
+    /* Paths and network settings are compared as they are */
+    g_string_append_printf (key,"%s\n%s\n%s\n%s\n",
+                            (query->musictree_path) ? query->musictree_path : "",
+                            (query->download_dir) ? query->download_dir : "",
+                            (query->proxy) ? query->proxy : "",
+                            (query->useragent) ? query->useragent : "");
+    return g_string_free (key,FALSE);
+}
+
+/////////////////////////////////
+
+/* Same url, but other options that shape the download, are different downloads */
+gchar * flight_url_key (const gchar * url, const gchar * endmarker, GlyrQuery * query)
+{
+    GString * key = g_string_new ("url\n");
+    g_string_append_printf (key,"%s\n%s\n",url, (endmarker) ? endmarker : "");
+    if (query != NULL)
+    {
+        g_string_append_printf (key,"%ld\n%s\n%s\n%s\n",
+                                query->max_bytes,
+                                (query->download_dir) ? query->download_dir : "",
+                                (query->proxy) ? query->proxy : "",
+                                (query->useragent) ? query->useragent : "");
+    }
+    return g_string_free (key,FALSE);
+}
+
+/////////////////////////////////
+
+/* Join the flight for key, or start it. *leader tells which one it was.
+ * Returns NULL if there is no table (library not initialized).
+ */
+Flight * flight_join (const gchar * key, gboolean * leader)
+{
+    Flight * flight = NULL;
+    *leader = TRUE;
+
+    g_mutex_lock (&flight_lock);
+    if (flight_table != NULL && key != NULL)
+    {
+        flight = g_hash_table_lookup (flight_table,key);
+        if (flight != NULL)
+        {
+            *leader = FALSE;
+        }
+        else
+        {
+            flight = g_malloc0 (sizeof (Flight) );
+            flight->key = g_strdup (key);
+            g_hash_table_insert (flight_table,flight->key,flight);
+        }
+        flight->refs++;
+    }
+    g_mutex_unlock (&flight_lock);
+    return flight;
+}
+
+/////////////////////////////////
+
+/* Needs flight_lock */
+static void flight_finish (Flight * flight)
+{
+    if (flight_table != NULL && g_hash_table_lookup (flight_table,flight->key) == flight)
+    {
+        g_hash_table_remove (flight_table,flight->key);
+    }
+    g_cond_broadcast (&flight_cond);
+    flight_unref (flight);
+}
+
+/////////////////////////////////
+
+/* Leader is done; head is copied for the duplicates and stays the leader's */
+void flight_land (Flight * flight, GlyrMemCache * head, GLYR_ERROR error)
+{
+    if (flight == NULL)
+    {
+        return;
+    }
+
+    g_mutex_lock (&flight_lock);
+
+    /* Nobody can join anymore once landed; copy only if somebody waits */
+    if (flight->refs > 1)
+    {
+        for (GlyrMemCache * elem = head; elem; elem = elem->next)
+        {
+            flight->items = g_list_prepend (flight->items,DL_copy (elem) );
+        }
+        flight->items = g_list_reverse (flight->items);
+    }
+    flight->error = error;
+    flight->landed = TRUE;
+    flight_finish (flight);
+    g_mutex_unlock (&flight_lock);
+}
+
+/////////////////////////////////
+
+/* Leader was stopped; nothing to share */
+void flight_abort (Flight * flight)
+{
+    if (flight != NULL)
+    {
+        g_mutex_lock (&flight_lock);
+        flight->aborted = TRUE;
+        flight_finish (flight);
+        g_mutex_unlock (&flight_lock);
+    }
+}
+
+/////////////////////////////////
+
+/* Let waiting duplicates check for glyr_signal_exit() */
+void flight_interrupt (void)
+{
+    g_mutex_lock (&flight_lock);
+    g_cond_broadcast (&flight_cond);
+    g_mutex_unlock (&flight_lock);
+}
+
+/////////////////////////////////
+
+/* Wait for the leader. TRUE if its results were copied to *head,
+ * FALSE if the duplicate has to do the work itself, or was stopped.
+ */
+gboolean flight_wait (Flight * flight, GlyrQuery * query, GlyrMemCache ** head, GLYR_ERROR * error)
+{
+    gboolean shared = FALSE;
+    *head = NULL;
+
+    g_mutex_lock (&flight_lock);
+    while (flight->landed == FALSE && flight->aborted == FALSE)
+    {
+        if (query != NULL && (GET_ATOMIC_SIGNAL_EXIT (query) || query_deadline_passed (query) ) )
+        {
+            break;
+        }
+
+        gint64 deadline = g_get_monotonic_time() + FLIGHT_POLL_INTERVAL * G_TIME_SPAN_MILLISECOND;
+        g_cond_wait_until (&flight_cond,&flight_lock,deadline);
+    }
+
+    if (flight->landed == TRUE)
+    {
+        /* Copies are linked like the list glyr_get() returns */
+        GlyrMemCache * prev = NULL;
+        for (GList * elem = flight->items; elem; elem = elem->next)
+        {
+            GlyrMemCache * copy = DL_copy (elem->data);
+            copy->prev = prev;
+            copy->next = NULL;
+            if (prev != NULL)
+            {
+                prev->next = copy;
+            }
+            else
+            {
+                *head = copy;
+            }
+            prev = copy;
+        }
+        *error = flight->error;
+        shared = TRUE;
+    }
+
+    flight_unref (flight);
+    g_mutex_unlock (&flight_lock);
+    return shared;
+}
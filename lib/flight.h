@@ -0,0 +1,42 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+#ifndef GLYR_FLIGHT_H
+#define GLYR_FLIGHT_H
+
+#include "core.h"
+
+/* How often (ms) a waiting duplicate checks its deadline, glyr_signal_exit() wakes it at once */
+#define FLIGHT_POLL_INTERVAL 100
+
+typedef struct _Flight Flight;
+
+void flight_init (void);
+void flight_destroy (void);
+
+gchar * flight_query_key (GlyrQuery * query);
+gchar * flight_url_key (const gchar * url, const gchar * endmarker, GlyrQuery * query);
+
+Flight * flight_join (const gchar * key, gboolean * leader);
+void flight_land (Flight * flight, GlyrMemCache * head, GLYR_ERROR error);
+void flight_abort (Flight * flight);
+void flight_interrupt (void);
+gboolean flight_wait (Flight * flight, GlyrQuery * query, GlyrMemCache ** head, GLYR_ERROR * error);
+
+#endif
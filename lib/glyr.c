@@ -27,6 +27,14 @@
 #include "blacklist.h"
 #include "cache.h"
 #include "stringlib.h"
+#include "netpool.h"
+#include "hostlimit.h"
+#include "provstats.h"
+#include "async.h"
+#include "flight.h"
+#include "respcache.h"
+#include "trace.h"
+#include "cache_intern.h"
 
 //////////////////////////////////
 
@@ -215,6 +223,18 @@ __attribute__ ( (visibility ("default") ) )
 void glyr_signal_exit (GlyrQuery * query)
 {
     SET_ATOMIC_SIGNAL_EXIT (query,1);
+
+    /* Don't wait for the next byte or timeout to notice */
+    engine_interrupt (query);
+    flight_interrupt();
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+GlyrTransferTrace * glyr_query_get_trace (GlyrQuery * query)
+{
+    return (query != NULL) ? query->trace_head : NULL;
 }
 
 /////////////////////////////////
@@ -537,6 +557,27 @@ GLYR_ERROR glyr_opt_download (GlyrQuery * s, bool download)
 
 /////////////////////////////////
 
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_download_dir (GlyrQuery * s, const char * path)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    if (path == NULL)
+    {
+        g_free ( (char*) s->info[9]);
+        s->info[9] = NULL;
+        s->download_dir = NULL;
+        return GLYRE_OK;
+    }
+
+    if (g_file_test (path,G_FILE_TEST_IS_DIR) == FALSE)
+    {
+        return GLYRE_BAD_VALUE;
+    }
+    return glyr_set_info (s,9,path);
+}
+
+/////////////////////////////////
+
 __attribute__ ( (visibility ("default") ) )
 GLYR_ERROR glyr_opt_force_utf8 (GlyrQuery * s, bool force_utf8)
 {
@@ -547,6 +588,81 @@ GLYR_ERROR glyr_opt_force_utf8 (GlyrQuery * s, bool force_utf8)
 
 /////////////////////////////////
 
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_multiplex (GlyrQuery * s, bool multiplex)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    s->multiplex = multiplex;
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_max_host_connections (GlyrQuery * s, int connections)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    if (connections < 0) return GLYRE_BAD_VALUE;
+    s->max_host_connections = connections;
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_max_host_streams (GlyrQuery * s, int streams)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    if (streams < 1) return GLYRE_BAD_VALUE;
+    s->max_host_streams = streams;
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_hedge (GlyrQuery * s, float percentile)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    if (percentile < 0.0 || percentile > 1.0) return GLYRE_BAD_VALUE;
+    s->hedge = percentile;
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_deadline (GlyrQuery * s, int ms)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    if (ms < 0) return GLYRE_BAD_VALUE;
+    s->deadline = ms;
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_max_bytes (GlyrQuery * s, long bytes)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    if (bytes < -1) return GLYRE_BAD_VALUE;
+    s->max_bytes = bytes;
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_trace (GlyrQuery * s, bool trace)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    s->trace = trace;
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
 __attribute__ ( (visibility ("default") ) )
 GLYR_ERROR glyr_opt_lookup_db (GlyrQuery * s, GlyrDatabase * db)
 {
@@ -581,6 +697,17 @@ GLYR_ERROR glyr_opt_db_autoread (GlyrQuery * s, bool db_autoread)
 
 /////////////////////////////////
 
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_opt_db_negative_ttl (GlyrQuery * s, int seconds)
+{
+    if (s == NULL) return GLYRE_EMPTY_STRUCT;
+    if (seconds < 0) return GLYRE_BAD_VALUE;
+    s->db_negative_ttl = seconds;
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
 __attribute__ ( (visibility ("default") ) )
 GLYR_ERROR glyr_opt_normalize (GlyrQuery * s, GLYR_NORMALIZATION norm)
 {
@@ -611,16 +738,25 @@ static void set_query_on_defaults (GlyrQuery * glyrs)
     glyrs->callback.download = NULL;
     glyrs->callback.user_pointer = NULL;
     glyrs->musictree_path = NULL;
+    glyrs->download_dir = NULL;
     glyrs->q_errno = GLYRE_OK;
 
     glyrs->db_autoread = GLYR_DEFAULT_DB_AUTOREAD;
     glyrs->db_autowrite = GLYR_DEFAULT_DB_AUTOWRITE;
+    glyrs->db_negative_ttl = GLYR_DEFAULT_DB_NEGATIVE_TTL;
     glyrs->from   = GLYR_DEFAULT_FROM;
     glyrs->img_min_size = GLYR_DEFAULT_CMINSIZE;
     glyrs->img_max_size = GLYR_DEFAULT_CMAXSIZE;
     glyrs->number = GLYR_DEFAULT_NUMBER;
     glyrs->parallel  = GLYR_DEFAULT_PARALLEL;
     glyrs->redirects = GLYR_DEFAULT_REDIRECTS;
+    glyrs->multiplex = GLYR_DEFAULT_MULTIPLEX;
+    glyrs->hedge = GLYR_DEFAULT_HEDGE;
+    glyrs->deadline = GLYR_DEFAULT_DEADLINE;
+    glyrs->max_bytes = GLYR_DEFAULT_MAX_BYTES;
+    glyrs->trace = GLYR_DEFAULT_TRACE;
+    glyrs->max_host_connections = GLYR_DEFAULT_MAX_HOST_CONNECTIONS;
+    glyrs->max_host_streams = GLYR_DEFAULT_MAX_HOST_STREAMS;
     glyrs->timeout   = GLYR_DEFAULT_TIMEOUT;
     glyrs->verbosity = GLYR_DEFAULT_VERBOSITY;
     glyrs->plugmax = GLYR_DEFAULT_PLUGMAX;
@@ -668,6 +804,7 @@ void glyr_query_destroy (GlyrQuery * sets)
                 sets->info[i] = NULL;
             }
         }
+        trace_free (sets->trace_head);
 
         /* Reset query so it can be used again */
         set_query_on_defaults (sets);
@@ -727,6 +864,50 @@ GlyrMemCache * glyr_cache_new (void)
 
 /////////////////////////////////
 
+// !! NOT THREADSAFE !! //
+__attribute__ ( (visibility ("default") ) )
+void glyr_pool_configure (GLYR_SHARE_FLAGS share, int max_idle)
+{
+    netpool_configure (share,max_idle);
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+void glyr_async_configure (int max_workers)
+{
+    async_configure (max_workers);
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+void glyr_response_cache_configure (size_t max_bytes, int max_age)
+{
+    respcache_configure (max_bytes,max_age);
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+void glyr_response_cache_stats (GlyrResponseCacheStats * stats)
+{
+    if (stats != NULL)
+    {
+        respcache_get_stats (stats);
+    }
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+void glyr_host_limit_configure (const char * host, double rate, int max_parallel)
+{
+    hostlimit_configure (host,rate,max_parallel);
+}
+
+/////////////////////////////////
+
 // !! NOT THREADSAFE !! //
 __attribute__ ( (visibility ("default") ) )
 void glyr_init (void)
@@ -744,6 +925,19 @@ void glyr_init (void)
             glyr_message (-1,NULL,"Fatal: libcurl failed to init\n");
         }
 
+        /* Shared DNS cache and TLS sessions, pooled connections, per-host budgets */
+        netpool_init();
+        hostlimit_init();
+
+        /* Observed provider performance, see get_queued() */
+        provstats_init();
+
+        /* Identical queries running at the same time share one result */
+        flight_init();
+
+        /* Responses of the providers, off unless configured */
+        respcache_init();
+
         /* Locale */
         if (setlocale (LC_ALL, "") == NULL)
         {
@@ -769,6 +963,17 @@ void glyr_cleanup (void)
 {
     if (is_initalized == TRUE)
     {
+        /* Let queries of glyr_get_async() and glyr_get_batch() finish first,
+         * nothing may use the pooled handles afterwards */
+        async_destroy();
+
+        /* Close all pooled connections, forget per-host budgets */
+        netpool_destroy();
+        hostlimit_destroy();
+        provstats_destroy();
+        flight_destroy();
+        respcache_destroy();
+
         /* Curl no longer needed */
         curl_global_cleanup();
 
@@ -866,6 +1071,153 @@ static void set_error (GLYR_ERROR err_in, GlyrQuery * query, GLYR_ERROR * err_ou
         }                                                   \
     }                                                       \
 
+/* The actual work of glyr_get(), without looking for duplicates */
+static GlyrMemCache * run_query (GlyrQuery * query, GLYR_ERROR * e, int * length)
+{
+    GList * result = NULL;
+    set_error (GLYRE_UNKNOWN_GET, query, e);
+
+    for (GList * elem = r_getFList(); elem; elem = elem->next)
+    {
+        MetaDataFetcher * item = elem->data;
+        if (query->type == item->type)
+        {
+            if (check_if_valid (query,item) == TRUE)
+            {
+                /* Print some user info, always useful */
+                if (query->normalization & GLYR_NORMALIZE_ARTIST) {
+                    PRINT_NORMALIZED_ATTR("- Artist   : ", query->normalization, query->artist);
+                } else {
+                    PRINT_NORMALIZED_ATTR("- Artist   : ", GLYR_NORMALIZE_NONE, query->artist);
+                }
+
+                if (query->normalization & GLYR_NORMALIZE_ALBUM) {
+                    PRINT_NORMALIZED_ATTR("- Album    : ", query->normalization, query->album);
+                } else {
+                    PRINT_NORMALIZED_ATTR("- Album    : ", GLYR_NORMALIZE_NONE, query->album);
+                }
+
+                if (query->normalization & GLYR_NORMALIZE_TITLE) {
+                    PRINT_NORMALIZED_ATTR("- Title    : ", query->normalization, query->title);
+                } else {
+                    PRINT_NORMALIZED_ATTR("- Title    : ", GLYR_NORMALIZE_NONE, query->title);
+                }
+
+                if (query->lang != NULL)
+                {
+                    glyr_message (2,query,"- Language : ");
+                    glyr_message (2,query,"%s\n",query->lang);
+                }
+
+                set_error (GLYRE_OK, query, e);
+                glyr_message (2,query,"- Type     : %s\n\n",item->name);
+
+                /* Lookup what we search for here: Images (url, or raw) or text */
+                query->imagejob = ! (item->full_data);
+
+                /* If ->parallel is <= 0, it gets autodetected */
+                auto_detect_parallel (item, query);
+
+                /* Now start your engines, gentlemen */
+                result = start_engine (query,item,e);
+                break;
+            }
+            else
+            {
+                set_error (GLYRE_INSUFF_DATA, query, e);
+            }
+        }
+    }
+
+    /* Make this query reusable */
+    query->itemctr = 0;
+
+    /* Let the next run start with what we learned about the providers, failures included */
+    if (query->db_autowrite && query->local_db)
+    {
+        db_save_provider_stats (query->local_db);
+    }
+
+    /* Start of the returned list */
+    GlyrMemCache * head = NULL;
+
+    /* Librarby was stopped, just return NULL. */
+    if (result != NULL && GET_ATOMIC_SIGNAL_EXIT (query) )
+    {
+        for (GList * elem = result; elem; elem = elem->next)
+            DL_free (elem->data);
+
+        g_list_free (result);
+        result = NULL;
+
+        set_error (GLYRE_WAS_STOPPED, query, e);
+    }
+
+    /* Set the length */
+    if (length != NULL)
+    {
+        *length = g_list_length (result);
+    }
+
+    /* free if empty */
+    if (result != NULL)
+    {
+        /* Count inserstions */
+        gint db_inserts = 0;
+
+        /* link caches to each other */
+        for (GList * elem = result; elem; elem = elem->next)
+        {
+            GlyrMemCache * item = elem->data;
+            item->next = (elem->next) ? elem->next->data : NULL;
+            item->prev = (elem->prev) ? elem->prev->data : NULL;
+
+            if (query->db_autowrite && query->local_db && item->cached == FALSE)
+            {
+                db_inserts++;
+                glyr_db_insert (query->local_db,query,item);
+            }
+        }
+
+        if (db_inserts > 0)
+        {
+            glyr_message (2,query,"--- Inserted %d item%s into db.\n",db_inserts, (db_inserts == 1) ? "" : "s");
+        }
+
+        /* Finish. */
+        if (g_list_first (result) )
+        {
+            head = g_list_first (result)->data;
+        }
+
+        g_list_free (result);
+        result = NULL;
+    }
+
+    return head;
+}
+
+/////////////////////////////////
+
+/* Take over the copied results of an identical query.
+ * Queries with a download callback are never shared, see flight_query_key().
+ */
+static GlyrMemCache * share_results (GlyrMemCache * head, int * length)
+{
+    if (length != NULL)
+    {
+        gint count = 0;
+        for (GlyrMemCache * elem = head; elem; elem = elem->next)
+        {
+            count++;
+        }
+        *length = count;
+    }
+    return head;
+}
+
+/////////////////////////////////
+
 __attribute__ ( (visibility ("default") ) )
 GlyrMemCache * glyr_get (GlyrQuery * query, GLYR_ERROR * e, int * length)
 {
@@ -888,118 +1240,48 @@ GlyrMemCache * glyr_get (GlyrQuery * query, GLYR_ERROR * e, int * length)
             glyr_opt_lang (query,"auto");
         }
 
-        GList * result = NULL;
-        set_error (GLYRE_UNKNOWN_GET, query, e);
+        /* Only this run's transfers */
+        trace_free (query->trace_head);
+        query->trace_head = NULL;
 
-        for (GList * elem = r_getFList(); elem; elem = elem->next)
-        {
-            MetaDataFetcher * item = elem->data;
-            if (query->type == item->type)
-            {
-                if (check_if_valid (query,item) == TRUE)
-                {
-                    /* Print some user info, always useful */
-                    if (query->normalization & GLYR_NORMALIZE_ARTIST) {
-                        PRINT_NORMALIZED_ATTR("- Artist   : ", query->normalization, query->artist);
-                    } else {
-                        PRINT_NORMALIZED_ATTR("- Artist   : ", GLYR_NORMALIZE_NONE, query->artist);
-                    }
-
-                    if (query->normalization & GLYR_NORMALIZE_ALBUM) {
-                        PRINT_NORMALIZED_ATTR("- Album    : ", query->normalization, query->album);
-                    } else {
-                        PRINT_NORMALIZED_ATTR("- Album    : ", GLYR_NORMALIZE_NONE, query->album);
-                    }
-
-                    if (query->normalization & GLYR_NORMALIZE_TITLE) {
-                        PRINT_NORMALIZED_ATTR("- Title    : ", query->normalization, query->title);
-                    } else {
-                        PRINT_NORMALIZED_ATTR("- Title    : ", GLYR_NORMALIZE_NONE, query->title);
-                    }
-
-                    if (query->lang != NULL)
-                    {
-                        glyr_message (2,query,"- Language : ");
-                        glyr_message (2,query,"%s\n",query->lang);
-                    }
-
-                    set_error (GLYRE_OK, query, e);
-                    glyr_message (2,query,"- Type     : %s\n\n",item->name);
-
-                    /* Lookup what we search for here: Images (url, or raw) or text */
-                    query->imagejob = ! (item->full_data);
-
-                    /* If ->parallel is <= 0, it gets autodetected */
-                    auto_detect_parallel (item, query);
-
-                    /* Now start your engines, gentlemen */
-                    result = start_engine (query,item,e);
-                    break;
-                }
-                else
-                {
-                    set_error (GLYRE_INSUFF_DATA, query, e);
-                }
-            }
-        }
+        /* The clock for glyr_opt_deadline() starts now */
+        query->deadline_at = (query->deadline > 0) ? g_get_monotonic_time() + query->deadline * G_TIME_SPAN_MILLISECOND : 0;
 
-        /* Make this query reusable */
-        query->itemctr = 0;
+        /* Somebody else might be asking the very same right now */
+        gchar * key = flight_query_key (query);
+        gboolean leader = TRUE;
+        Flight * flight = flight_join (key,&leader);
+        g_free (key);
 
-        /* Start of the returned list */
         GlyrMemCache * head = NULL;
-
-        /* Librarby was stopped, just return NULL. */
-        if (result != NULL && GET_ATOMIC_SIGNAL_EXIT (query) )
-        {
-            for (GList * elem = result; elem; elem = elem->next)
-                DL_free (elem->data);
-
-            g_list_free (result);
-            result = NULL;
-
-            set_error (GLYRE_WAS_STOPPED, query, e);
-        }
-
-        /* Set the length */
-        if (length != NULL)
+        GLYR_ERROR error = GLYRE_OK;
+        if (leader == FALSE && flight_wait (flight,query,&head,&error) == TRUE)
         {
-            *length = g_list_length (result);
+            glyr_message (2,query,"- Sharing the results of an identical query\n");
+            head = share_results (head,length);
+            set_error (error, query, e);
         }
-
-        /* free if empty */
-        if (result != NULL)
+        else if (leader == FALSE)
         {
-            /* Count inserstions */
-            gint db_inserts = 0;
-
-            /* link caches to each other */
-            for (GList * elem = result; elem; elem = elem->next)
+            /* Leader was stopped, or we were - or our time is up */
+            head = (GET_ATOMIC_SIGNAL_EXIT (query) || query_deadline_passed (query) ) ? NULL : run_query (query,e,length);
+            if (head == NULL && GET_ATOMIC_SIGNAL_EXIT (query) )
             {
-                GlyrMemCache * item = elem->data;
-                item->next = (elem->next) ? elem->next->data : NULL;
-                item->prev = (elem->prev) ? elem->prev->data : NULL;
-
-                if (query->db_autowrite && query->local_db && item->cached == FALSE)
-                {
-                    db_inserts++;
-                    glyr_db_insert (query->local_db,query,item);
-                }
+                set_error (GLYRE_WAS_STOPPED, query, e);
             }
-
-            if (db_inserts > 0)
+        }
+        else
+        {
+            head = run_query (query,e,length);
+            if (GET_ATOMIC_SIGNAL_EXIT (query) || query_deadline_passed (query) )
             {
-                glyr_message (2,query,"--- Inserted %d item%s into db.\n",db_inserts, (db_inserts == 1) ? "" : "s");
+                /* Others might have more time than we had */
+                flight_abort (flight);
             }
-
-            /* Finish. */
-            if (g_list_first (result) )
+            else
             {
-                head = g_list_first (result)->data;
+                flight_land (flight,head,query->q_errno);
             }
-
-            g_list_free (result);
-            result = NULL;
         }
 
         /* Done! */
@@ -1014,6 +1296,58 @@ GlyrMemCache * glyr_get (GlyrQuery * query, GLYR_ERROR * e, int * length)
 
 /////////////////////////////////
 
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_get_async (GlyrQuery * query, GlyrAsyncItemCB on_item, GlyrAsyncDoneCB on_done, void * userdata)
+{
+    if (is_initalized == FALSE || QUERY_IS_INITALIZED (query) == FALSE)
+    {
+        glyr_message (-1,NULL,"Warning: Either query or library is not initialized.\n");
+        return GLYRE_NO_INIT;
+    }
+    return async_submit (query,on_item,on_done,userdata);
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+int glyr_get_async_fd (void)
+{
+    return (is_initalized) ? async_get_fd() : -1;
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+int glyr_dispatch (void)
+{
+    return async_dispatch();
+}
+
+/////////////////////////////////
+
+__attribute__ ( (visibility ("default") ) )
+GLYR_ERROR glyr_get_batch (GlyrQuery ** queries, size_t n, int parallel, GlyrBatchStats * stats)
+{
+    if (is_initalized == FALSE || (queries == NULL && n != 0) )
+    {
+        return GLYRE_NO_INIT;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (QUERY_IS_INITALIZED (queries[i]) == FALSE)
+        {
+            glyr_message (-1,NULL,"Warning: query #%lu of the batch is not initialized.\n", (unsigned long) i);
+            return GLYRE_NO_INIT;
+        }
+    }
+
+    async_run_batch (queries,n, (parallel > 0) ? parallel : GLYR_DEFAULT_BATCH_PARALLEL,stats);
+    return GLYRE_OK;
+}
+
+/////////////////////////////////
+
 __attribute__ ( (visibility ("default") ) )
 int glyr_cache_write (GlyrMemCache * data, const char * path)
 {
@@ -1096,6 +1430,9 @@ static int glyr_set_info (GlyrQuery * s, int at, const char * arg)
         case 8:
             s->musictree_path = (gchar * ) s->info[at];
             break;
+        case 9:
+            s->download_dir = (gchar * ) s->info[at];
+            break;
         default:
             glyr_message (2,s,"Warning: wrong <at> for glyr_info_at!\n");
         }
@@ -66,6 +66,10 @@ extern "C"
      * </programlisting>
      * </informalexample>
      *
+     * Queries of glyr_get_async() that are still running are stopped, queued ones are not started anymore.
+     * Their @on_done is called from here: with whatever was found, or with GLYRE_STOP_PRE
+     * if the query never ran. Items not passed to glyr_dispatch() yet are dropped.
+     *
      * <note>
      * <para>
      * This function is not threadsafe.
@@ -74,6 +78,66 @@ extern "C"
      **/
     void glyr_cleanup (void);
 
+    /**
+     * glyr_pool_configure:
+     * @share: What the pooled handles share, a bitmask of #GLYR_SHARE_FLAGS
+     * @max_idle: How many unused handles are kept around for later downloads
+     *
+     * libglyr keeps a pool of curl handles, which is created by glyr_init() and
+     * shared by all queries and threads. Back to back queries against the same
+     * hosts can therefore skip the DNS lookup and the TCP/TLS handshakes.
+     *
+     * Defaults are GLYR_DEFAULT_SHARE and GLYR_DEFAULT_POOL_MAX_IDLE.
+     * <note>
+     * <para>
+     * This function is not threadsafe. Call it before glyr_init(),
+     * the settings are applied on the next glyr_init().
+     * </para>
+     * </note>
+     **/
+    void glyr_pool_configure (GLYR_SHARE_FLAGS share, int max_idle);
+
+    /**
+     * glyr_response_cache_configure:
+     * @max_bytes: Memory the cached responses may use; 0 disables the cache (the default).
+     * @max_age: Seconds a response is served from memory without asking the server.
+     *
+     * libglyr can remember the responses of the providers, keyed by their URL.
+     * Responses younger than @max_age are served without any network I/O,
+     * older ones are revalidated with If-None-Match / If-Modified-Since,
+     * if the server sent an ETag or Last-Modified header.
+     * The least recently used responses are dropped once @max_bytes are used.
+     *
+     * The cache is shared by all queries and threads, and emptied by glyr_cleanup().
+     * Defaults are GLYR_DEFAULT_RESPONSE_CACHE_SIZE and GLYR_DEFAULT_RESPONSE_CACHE_AGE.
+     */
+    void glyr_response_cache_configure (size_t max_bytes, int max_age);
+
+    /**
+     * glyr_response_cache_stats:
+     * @stats: Filled with hit and miss counters and the current size of the cache.
+     *
+     * See glyr_response_cache_configure().
+     */
+    void glyr_response_cache_stats (GlyrResponseCacheStats * stats);
+
+    /**
+     * glyr_host_limit_configure:
+     * @host: Hostname like "musicbrainz.org", as it appears in the URLs of a provider.
+     * @rate: Max. requests per second to @host; 0 for no limit.
+     * @max_parallel: Max. requests to @host running at the same time; 0 for no limit.
+     *
+     * All queries of the process share one budget per host, transfers over budget
+     * wait until the host may be asked again. By default musicbrainz.org is asked
+     * at most once per second with one request at a time, and ws.audioscrobbler.com
+     * five times per second, as their terms of use demand. Other hosts are not limited.
+     *
+     * Use this to tighten those limits, to limit other hosts, or to lift a limit
+     * (when running against a mirror, for example). Requests already running stay counted.
+     * glyr_cleanup() restores the defaults.
+     */
+    void glyr_host_limit_configure (const char * host, double rate, int max_parallel);
+
 
     /**
      * glyr_get:
@@ -85,12 +149,87 @@ extern "C"
      *
      * Once an item is found the callback (set via glyr_opt_dlcallback()) is called anytime a item is ready
      *
+     * If an identical query (same type, artist, album, title, providers, number and so on)
+     * is already running in another thread, this waits for it and returns a copy of its results.
+     * They are still passed through your callback.
      *
      * Returns:: a doubly linked list of #GlyrMemCache, which should be freed by passing any element of the to glyr_free_list()
      *
      */
     GlyrMemCache * glyr_get (GlyrQuery * settings, GLYR_ERROR * error, int * length);
 
+    /**
+     * glyr_get_async:
+     * @settings: The setting struct controlling glyr, like in glyr_get()
+     * @on_item: Called for every item that was found, or %NULL
+     * @on_done: Called once the query is done, with the same results glyr_get() returns, or %NULL
+     * @userdata: Passed to both callbacks.
+     *
+     * Starts the query and returns immediately. It is run by glyr_get() on a thread pool
+     * owned by libglyr, GLYR_DEFAULT_ASYNC_WORKERS threads big unless changed with
+     * glyr_async_configure(); queries beyond that wait for a free thread.
+     * The callbacks are not called from there, but from glyr_dispatch(),
+     * so they run in your thread. Wait for glyr_get_async_fd() to become
+     * readable and call glyr_dispatch() then, e.g. from a GLib, libuv or epoll loop.
+     *
+     * @settings must not be modified or destroyed until @on_done was called,
+     * but glyr_signal_exit() may be used on it. A callback set with glyr_opt_dlcallback()
+     * is still called, but on libglyr's thread.
+     *
+     * Returns: GLYRE_OK if the query was started, GLYRE_NO_INIT if glyr_init() was not called yet.
+     */
+    GLYR_ERROR glyr_get_async (GlyrQuery * settings, GlyrAsyncItemCB on_item, GlyrAsyncDoneCB on_done, void * userdata);
+
+    /**
+     * glyr_async_configure:
+     * @max_workers: How many queries of glyr_get_async() may run at once; 0 for GLYR_DEFAULT_ASYNC_WORKERS.
+     *
+     * Every running query occupies one thread of the pool while it waits for its downloads.
+     * Takes effect right away, also for queries that wait for a thread already.
+     */
+    void glyr_async_configure (int max_workers);
+
+    /**
+     * glyr_get_async_fd:
+     *
+     * A file descriptor that becomes readable once callbacks of glyr_get_async()
+     * are ready to be dispatched. Don't read from it or close it, glyr_dispatch() takes care.
+     * It stays the same until glyr_cleanup() is called.
+     *
+     * Returns: the file descriptor, or -1 if this platform has none; poll glyr_dispatch() then.
+     */
+    int glyr_get_async_fd (void);
+
+    /**
+     * glyr_dispatch:
+     *
+     * Calls the callbacks of glyr_get_async() for everything that happened
+     * since the last call. Never blocks.
+     *
+     * Returns: the number of callbacks that were called.
+     */
+    int glyr_dispatch (void);
+
+    /**
+     * glyr_get_batch:
+     * @queries: An array of @n initialized queries.
+     * @n: Number of queries in @queries
+     * @parallel: How many queries may run at once; 0 for a default of 8.
+     * @stats: Filled with the throughput of the batch, or %NULL
+     *
+     * Runs many queries at once and returns when all of them are done.
+     * All of them share libglyr's connections, DNS cache and per-host limits,
+     * so enriching a whole library this way is polite to the providers.
+     *
+     * Results are delivered through each query's callback set by glyr_opt_dlcallback(),
+     * which is called from one of libglyr's threads. Items passed there are freed
+     * once their query is done, use glyr_cache_copy() to keep them.
+     * Errors are stored in the q_errno field of each query.
+     *
+     * Returns: GLYRE_OK, GLYRE_NO_INIT if glyr_init() was not called or a query is not initialized.
+     */
+    GLYR_ERROR glyr_get_batch (GlyrQuery ** queries, size_t n, int parallel, GlyrBatchStats * stats);
+
     /**
      * glyr_query_init:
      * @query: The GlyrQuery to initialize to defaultsettings.
@@ -114,6 +253,8 @@ extern "C"
      * @query: The currently running query you want to stop.
      *
      * Try to stop libglyr as soon as possible.
+     * Running downloads of @query are aborted right away,
+     * so glyr_get() usually returns within a few milliseconds.
      * This is supposed to be called on another thread.
      * Calling this function twice on the same query will do nothing.
      * <note>
@@ -126,6 +267,20 @@ extern "C"
      */
     void glyr_signal_exit (GlyrQuery * query);
 
+    /**
+     * glyr_query_get_trace:
+     * @query: A query that was passed to glyr_get() with glyr_opt_trace() enabled.
+     *
+     * The transfers of the last glyr_get() (plus glyr_download() calls since then),
+     * most recent first. A query that shared the results of an identical one
+     * running at the same time did no transfers itself.
+     *
+     * The list belongs to @query; it is valid until the next glyr_get() or glyr_query_destroy().
+     *
+     * Returns: the first GlyrTransferTrace, or NULL.
+     */
+    GlyrTransferTrace * glyr_query_get_trace (GlyrQuery * query);
+
     /**
      * glyr_free_list:
      * @head: The head of the doubly linked list that should be freed.
@@ -486,6 +641,110 @@ extern "C"
     */
     GLYR_ERROR glyr_opt_redirects (GlyrQuery * s, unsigned long redirects);
 
+    /**
+    * glyr_opt_multiplex:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @multiplex: true to multiplex requests over HTTP/2 connections.
+    *
+    * If enabled (the default), libglyr asks for HTTP/2 on https urls,
+    * and parallel requests to the same host wait for an existing connection
+    * instead of opening a new one. Requests are then multiplexed as streams
+    * over this connection. Servers speaking only HTTP/1.1 are not affected.
+    *
+    * Returns: an error ID
+    */
+    GLYR_ERROR glyr_opt_multiplex (GlyrQuery * s, bool multiplex);
+
+    /**
+    * glyr_opt_max_host_connections:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @connections: Max. number of connections to one host, 0 means no limit.
+    *
+    * Requests beyond this limit are queued until a connection is free,
+    * or are multiplexed over an existing one, see glyr_opt_multiplex().
+    *
+    * Returns: an error ID, GLYRE_BAD_VALUE if @connections is negative.
+    */
+    GLYR_ERROR glyr_opt_max_host_connections (GlyrQuery * s, int connections);
+
+    /**
+    * glyr_opt_max_host_streams:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @streams: Max. number of requests multiplexed over one connection.
+    *
+    * Only has an effect with glyr_opt_multiplex() and a libcurl of 7.67 or newer.
+    * The server may announce a lower limit, which is respected then.
+    *
+    * Returns: an error ID, GLYRE_BAD_VALUE if @streams is smaller than 1.
+    */
+    GLYR_ERROR glyr_opt_max_host_streams (GlyrQuery * s, int streams);
+
+    /**
+    * glyr_opt_hedge:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @percentile: A latency percentile between 0.0 and 1.0, 0.0 disables hedging.
+    *
+    * Up to glyr_opt_parallel() providers are queried at once; when one is
+    * done, the next best provider takes its place.
+    * With hedging, if no item came in after the @percentile latency
+    * of the fastest provider started first (e.g. 0.95), one more provider
+    * is started in parallel. Once enough items are there, the remaining
+    * downloads are cancelled. Without any latency known yet, half of
+    * glyr_opt_timeout() is waited.
+    *
+    * Disabled by default.
+    *
+    * Returns: an error ID, GLYRE_BAD_VALUE if @percentile is out of range.
+    */
+    GLYR_ERROR glyr_opt_hedge (GlyrQuery * s, float percentile);
+
+    /**
+    * glyr_opt_deadline:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @ms: Time budget of one glyr_get() in milliseconds, 0 disables it.
+    *
+    * glyr_opt_timeout() applies to each single download, and a query does
+    * many of them - some after each other. The deadline is the limit for
+    * the query as a whole: every download, image-type check and nested
+    * download is cut short when it is reached, and the items found until
+    * then are returned. Items that were not completely downloaded yet are lost.
+    *
+    * Disabled by default.
+    *
+    * Returns: an error ID, GLYRE_BAD_VALUE if @ms is negative.
+    */
+    GLYR_ERROR glyr_opt_deadline (GlyrQuery * s, int ms);
+
+    /**
+    * glyr_opt_max_bytes:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @bytes: Max. size of a single download, 0 disables the limit, -1 restores the default.
+    *
+    * The limit applies to the decoded body. Uncompressed downloads that announce
+    * a larger Content-Length are rejected before their body is transferred,
+    * all others are aborted as soon as they cross the limit. Either way, nothing of them is kept.
+    *
+    * By default (-1) only images are limited, to GLYR_DEFAULT_MAX_IMAGE_BYTES (16 MiB).
+    *
+    * Returns: an error ID, GLYRE_BAD_VALUE if @bytes is smaller than -1.
+    */
+    GLYR_ERROR glyr_opt_max_bytes (GlyrQuery * s, long bytes);
+
+    /**
+    * glyr_opt_trace:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @trace: true to record the timing of each transfer.
+    *
+    * Records DNS, connect, TLS, first byte and total times, the received bytes and the
+    * time spent parsing for every download of glyr_get() and glyr_download().
+    * Read them with glyr_query_get_trace() afterwards.
+    *
+    * Disabled by default.
+    *
+    * Returns: an error ID
+    */
+    GLYR_ERROR glyr_opt_trace (GlyrQuery * s, bool trace);
+
     /**
     * glyr_opt_useragent:
     * @s: The GlyrQuery settings struct to store this option in.
@@ -670,6 +929,22 @@ extern "C"
     */
     GLYR_ERROR glyr_opt_download (GlyrQuery * s, bool download);
 
+    /**
+    * glyr_opt_download_dir:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @path: An existing, writable directory; or NULL to keep images in memory (default)
+    *
+    * Downloaded images are streamed into @path instead of being held in memory.
+    * Each one is written to a temporary file first and renamed to '<md5sum>.<format>' once complete,
+    * the #GlyrMemCache's path field points to it then, and its data is mapped (read-only, no trailing NUL) from there.
+    *
+    * Images you skip in the callback are removed again, all others stay after glyr_free_list().
+    * Only useful if glyr_opt_download() is #TRUE.
+    *
+    * Returns: an error ID; GLYRE_BAD_VALUE if @path is no directory.
+    */
+    GLYR_ERROR glyr_opt_download_dir (GlyrQuery * s, const char * path);
+
     /**
     * glyr_opt_fuzzyness:
     * @s: The GlyrQuery settings struct to store this option in.
@@ -838,6 +1113,24 @@ extern "C"
     **/
     GLYR_ERROR glyr_opt_db_autoread (GlyrQuery * s, bool read_from_db);
 
+    /**
+    * glyr_opt_db_negative_ttl:
+    * @s: The GlyrQuery settings struct to store this option in.
+    * @seconds: How long a miss is remembered, 0 disables it.
+    *
+    * If a database is given via glyr_opt_lookup_db() libglyr also remembers
+    * which providers found nothing for a query (with db_autowrite).
+    * When the very same query is repeated within @seconds those providers
+    * are skipped (with db_autoread), instead of asking - and waiting for - them again.
+    * A provider that delivers something is forgotten from this list.
+    *
+    * Set it to 0 to ask every provider, regardless of what happened before.
+    * The default is one day.
+    *
+    * Returns: an error ID
+    */
+    GLYR_ERROR glyr_opt_db_negative_ttl (GlyrQuery * s, int seconds);
+
     /**
      * glyr_opt_musictree_path:
     * @s: The GlyrQuery settings struct to store this option in.
@@ -0,0 +1,254 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+/* Per-host politeness, shared by all queries of the process.
+ *
+ * Every host may have a token bucket (requests per second) and
+ * a cap on the number of parallel requests. Transfers that are over
+ * budget are not started yet - the engine keeps them queued,
+ * download_single() runs its transfer through an engine too.
+ * host_policies are the defaults, glyr_host_limit_configure() changes them.
+ * Other hosts are not limited at all.
+ */
+#include <string.h>
+
+#include "hostlimit.h"
+
+/////////////////////////////////
+
+typedef struct
+{
+    gdouble rate;     /* Tokens per second, 0 = unlimited */
+    gdouble tokens;   /* Currently available tokens       */
+    gint64 refilled;  /* Monotonic time of the last refill */
+
+    gint max_active;  /* Max. parallel requests, 0 = unlimited */
+    gint active;
+
+} HostBudget;
+
+/* What the services ask for in their terms of use */
+static const struct
+{
+    const gchar * host;
+    gdouble rate;
+    gint max_active;
+} host_policies[] =
+{
+    { "musicbrainz.org",       1.0, 1 },
+    { "ws.audioscrobbler.com", 5.0, 0 }
+};
+
+/* host -> HostBudget, protected by budget_lock */
+static GHashTable * budget_table = NULL;
+static GMutex budget_lock;
+
+/////////////////////////////////
+
+/* "http://user@Some.Host:80/path" -> "some.host" */
+static gchar * host_of (const gchar * url)
+{
+    const gchar * begin = strstr (url,"://");
+    begin = (begin) ? begin + 3 : url;
+
+    const gchar * at = strchr (begin,'@');
+    const gchar * slash = strchr (begin,'/');
+    if (at != NULL && (slash == NULL || at < slash) )
+    {
+        begin = at + 1;
+    }
+
+    gsize len = strcspn (begin,":/?#");
+    return g_ascii_strdown (begin,len);
+}
+
+/////////////////////////////////
+
+static void refill (HostBudget * budget, gint64 now)
+{
+    gdouble burst = MAX (budget->rate,1.0);
+    budget->tokens = MIN (burst, budget->tokens + budget->rate * (now - budget->refilled) / G_USEC_PER_SEC);
+    budget->refilled = now;
+}
+
+/////////////////////////////////
+
+/* Limit host, budget_lock must be held.
+ * Requests already running to host stay counted.
+ */
+static void configure_host (const gchar * host, gdouble rate, gint max_active)
+{
+    HostBudget * budget = g_hash_table_lookup (budget_table,host);
+    if (budget == NULL)
+    {
+        budget = g_malloc0 (sizeof (HostBudget) );
+        budget->tokens = 1.0;
+        budget->refilled = g_get_monotonic_time();
+        g_hash_table_insert (budget_table,g_strdup (host),budget);
+    }
+
+    budget->rate = MAX (rate,0.0);
+    budget->max_active = MAX (max_active,0);
+    budget->tokens = MIN (budget->tokens,MAX (budget->rate,1.0) );
+}
+
+/////////////////////////////////
+
+/* Create the table with the defaults, budget_lock must be held */
+static void load_policies (void)
+{
+    if (budget_table == NULL)
+    {
+        budget_table = g_hash_table_new_full (g_str_hash,g_str_equal,g_free,g_free);
+        for (gsize i = 0; i < G_N_ELEMENTS (host_policies); i++)
+        {
+            configure_host (host_policies[i].host,host_policies[i].rate,host_policies[i].max_active);
+        }
+    }
+}
+
+/////////////////////////////////
+
+void hostlimit_init (void)
+{
+    g_mutex_lock (&budget_lock);
+    load_policies();
+    g_mutex_unlock (&budget_lock);
+}
+
+/////////////////////////////////
+
+void hostlimit_destroy (void)
+{
+    g_mutex_lock (&budget_lock);
+    if (budget_table != NULL)
+    {
+        g_hash_table_destroy (budget_table);
+        budget_table = NULL;
+    }
+    g_mutex_unlock (&budget_lock);
+}
+
+/////////////////////////////////
+
+/* Set the limits of host, replacing the default ones.
+ * rate and max_active of 0 make it unlimited.
+ */
+void hostlimit_configure (const gchar * host, gdouble rate, gint max_active)
+{
+    if (host == NULL)
+    {
+        return;
+    }
+
+    /* Same form as host_of() gives */
+    gchar * name = g_ascii_strdown (host,-1);
+
+    g_mutex_lock (&budget_lock);
+    load_policies();
+    configure_host (name,rate,max_active);
+    g_mutex_unlock (&budget_lock);
+
+    g_free (name);
+}
+
+/////////////////////////////////
+
+/* Ask for permission to start a request to url.
+ * On HOSTLIMIT_WAIT retry_at is set to the monotonic time
+ * when a token will be there, or -1 if waiting for a free slot.
+ */
+HostLimitResult hostlimit_acquire (const gchar * url, gint64 * retry_at)
+{
+    HostLimitResult result = HOSTLIMIT_UNLIMITED;
+    if (url == NULL)
+    {
+        return result;
+    }
+
+    g_mutex_lock (&budget_lock);
+    if (budget_table != NULL && g_hash_table_size (budget_table) != 0)
+    {
+        gchar * host = host_of (url);
+        HostBudget * budget = g_hash_table_lookup (budget_table,host);
+        if (budget != NULL)
+        {
+            gint64 now = g_get_monotonic_time();
+            gint64 ready_at = -1;
+            result = HOSTLIMIT_GRANTED;
+
+            if (budget->rate > 0)
+            {
+                refill (budget,now);
+                if (budget->tokens < 1.0)
+                {
+                    ready_at = now + (1.0 - budget->tokens) / budget->rate * G_USEC_PER_SEC;
+                    result = HOSTLIMIT_WAIT;
+                }
+            }
+
+            if (budget->max_active > 0 && budget->active >= budget->max_active)
+            {
+                ready_at = -1;
+                result = HOSTLIMIT_WAIT;
+            }
+
+            if (result == HOSTLIMIT_GRANTED)
+            {
+                if (budget->rate > 0)
+                {
+                    budget->tokens -= 1.0;
+                }
+                budget->active++;
+            }
+            else if (retry_at != NULL)
+            {
+                *retry_at = ready_at;
+            }
+        }
+        g_free (host);
+    }
+    g_mutex_unlock (&budget_lock);
+    return result;
+}
+
+/////////////////////////////////
+
+/* A request granted by hostlimit_acquire() finished */
+void hostlimit_release (const gchar * url)
+{
+    if (url == NULL)
+    {
+        return;
+    }
+
+    g_mutex_lock (&budget_lock);
+    if (budget_table != NULL)
+    {
+        gchar * host = host_of (url);
+        HostBudget * budget = g_hash_table_lookup (budget_table,host);
+        if (budget != NULL && budget->active > 0)
+        {
+            budget->active--;
+        }
+        g_free (host);
+    }
+    g_mutex_unlock (&budget_lock);
+}
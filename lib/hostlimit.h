@@ -0,0 +1,43 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+#ifndef GLYR_HOSTLIMIT_H
+#define GLYR_HOSTLIMIT_H
+
+#include <glib.h>
+
+/* How often to look again when a host has no free slot */
+#define HOSTLIMIT_POLL_INTERVAL 50
+
+typedef enum
+{
+    HOSTLIMIT_WAIT,      /* Over budget, try again later                     */
+    HOSTLIMIT_GRANTED,   /* Counted, call hostlimit_release() when finished  */
+    HOSTLIMIT_UNLIMITED  /* Host has no limits, nothing to release           */
+} HostLimitResult;
+
+void hostlimit_init (void);
+void hostlimit_destroy (void);
+
+void hostlimit_configure (const gchar * host, gdouble rate, gint max_active);
+
+HostLimitResult hostlimit_acquire (const gchar * url, gint64 * retry_at);
+void hostlimit_release (const gchar * url);
+
+#endif
@@ -135,39 +135,94 @@ const gchar * get_mbid_from_xml (GlyrQuery * s, GlyrMemCache * c, gint * offset)
 
 /////////////////////////////////
 
-/* Returns only a parseable memcache */
-GlyrMemCache * generic_musicbrainz_parse (cb_object * capo, gint * last_mbid, const gchar * include)
+/* The mbids of one search result, tried one after another */
+struct mbid_candidates
 {
-    gsize offset = 0;
-    const gchar * mbid = NULL;
-    GlyrMemCache * info = NULL;
+    GlyrMemCache * search;  /* Copy of the search result */
+    gint offset;            /* Where get_mbid_from_xml() goes on */
+    const gchar * type;
+    const gchar * include;
+    AsyncFollowupCB continuation;
+};
+
+static GList * try_mbid_candidate (cb_object * capo, gpointer userptr);
+
+/////////////////////////////////
+
+static void free_mbid_candidates (gpointer data)
+{
+    struct mbid_candidates * candidates = data;
+    DL_free (candidates->search);
+    g_free (candidates);
+}
+
+/////////////////////////////////
 
-    while (offset < capo->cache->size && info==NULL && (mbid = get_mbid_from_xml (capo->s,capo->cache,last_mbid) ) )
+/* Schedule the info page of the next matching mbid, if there is one */
+static void schedule_mbid_candidate (cb_object * capo, struct mbid_candidates * candidates)
+{
+    const gchar * mbid = get_mbid_from_xml (capo->s,candidates->search,&candidates->offset);
+    if (mbid == NULL)
     {
-        if (mbid != NULL)
-        {
-            const gchar * type = NULL;
-            switch (please_what_type (capo->s) )
-            {
-            case GLYR_TYPE_TAG_TITLE:
-                type = "track";
-                break;
-            case GLYR_TYPE_TAG_ALBUM:
-                type = "release";
-                break;
-            case GLYR_TYPE_TAG_ARTIST:
-                type = "artist";
-                break;
-            }
+        return;
+    }
 
-            gchar * info_page_url = g_strdup_printf ("http://musicbrainz.org/ws/1/%s/%s?type=xml&inc=%s",type,mbid,include);
-            if (info_page_url)
-            {
-                info = download_single (info_page_url,capo->s,NULL);
-                g_free (info_page_url);
-            }
-            g_free ( (gchar*) mbid);
-        }
+    gchar * info_page_url = g_strdup_printf ("http://musicbrainz.org/ws/1/%s/%s?type=xml&inc=%s",candidates->type,mbid,candidates->include);
+    if (info_page_url)
+    {
+        /* Every follow-up releases its own copy */
+        struct mbid_candidates * next = g_malloc0 (sizeof (struct mbid_candidates) );
+        *next = *candidates;
+        next->search = DL_copy (candidates->search);
+
+        async_followup (capo,info_page_url,try_mbid_candidate,next,free_mbid_candidates);
+        g_free (info_page_url);
+    }
+    g_free ( (gchar*) mbid);
+}
+
+/////////////////////////////////
+
+static GList * try_mbid_candidate (cb_object * capo, gpointer userptr)
+{
+    struct mbid_candidates * candidates = userptr;
+    GList * results = candidates->continuation (capo,NULL);
+    if (results == NULL)
+    {
+        /* Nothing on this page, the next match might have it */
+        schedule_mbid_candidate (capo,candidates);
+    }
+    return results;
+}
+
+/////////////////////////////////
+
+/* Schedule the info page of the first matching mbid as follow-up;
+ * the next one is only asked if continuation found nothing there
+ */
+void generic_musicbrainz_followup (cb_object * capo, const gchar * include, AsyncFollowupCB continuation)
+{
+    struct mbid_candidates candidates;
+    memset (&candidates,0,sizeof (candidates) );
+    candidates.search = capo->cache;
+    candidates.include = include;
+    candidates.continuation = continuation;
+
+    switch (please_what_type (capo->s) )
+    {
+    case GLYR_TYPE_TAG_TITLE:
+        candidates.type = "track";
+        break;
+    case GLYR_TYPE_TAG_ALBUM:
+        candidates.type = "release";
+        break;
+    case GLYR_TYPE_TAG_ARTIST:
+        candidates.type = "artist";
+        break;
+    }
+
+    if (candidates.type != NULL)
+    {
+        schedule_mbid_candidate (capo,&candidates);
     }
-    return info;
 }
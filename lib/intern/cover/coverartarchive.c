@@ -62,27 +62,29 @@ static GList * parse_archive_json (GlyrMemCache * input, GlyrQuery * qry)
 #define API_ROOT "http://coverartarchive.org/release/%s/"
 
 
+//////////////////////////////////////////////////
+
+static GList * cover_coverartarchive_parse_json (cb_object * capo, gpointer userptr)
+{
+    return parse_archive_json (capo->cache, capo->s);
+}
+
 //////////////////////////////////////////////////
 
 static GList * cover_coverartarchive_parse (cb_object * capo)
 {
-    GList *result_list = NULL;
     char * mbid = mbid_parse_data (capo->cache, "release", "title", capo->s->album, capo->s);
     if (mbid != NULL)
     {
         char * full_url = g_strdup_printf (API_ROOT, mbid);
         if (full_url != NULL)
         {
-            GlyrMemCache * json_data = download_single (full_url, capo->s, NULL);
-            if (json_data != NULL)
-            {
-                result_list = parse_archive_json (json_data, capo->s);
-                DL_free (json_data);
-            }
+            async_followup (capo, full_url, cover_coverartarchive_parse_json, NULL, NULL);
             g_free (full_url);
         }
+        g_free (mbid);
     }
-    return result_list;
+    return NULL;
 }
 
 //////////////////////////////////////////////////
@@ -53,12 +53,13 @@ static GList * cover_lastfm_parse (cb_object *capo)
 
     /* The result (perhaps) */
     GList * result_list = NULL;
+    GStringChunk * arena = capo_arena (capo);
     gchar * find  = capo->cache->data;
 
     while (continue_search (g_list_length (result_list),capo->s) && (find = strstr (find + sizeof(ALBUM_NODE), ALBUM_NODE) ) != NULL)
     {
-        gchar * artist = get_search_value (find, "<artist>", "</artist>");
-        gchar * album  = get_search_value (find, "<name>", "</name>");
+        gchar * artist = chunk_get_search_value (arena, find, "<artist>", "</artist>");
+        gchar * album  = chunk_get_search_value (arena, find, "<name>", "</name>");
 
         if (levenshtein_strnormcmp (capo->s, artist, capo->s->artist) <= capo->s->fuzzyness &&
             levenshtein_strnormcmp (capo->s, album,  capo->s->album) <= capo->s->fuzzyness) {
@@ -84,9 +85,6 @@ static GList * cover_lastfm_parse (cb_object *capo)
                 }
             }
         }
-
-        g_free (artist);
-        g_free (album);
     }
     return result_list;
 }
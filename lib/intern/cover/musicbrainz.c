@@ -40,7 +40,7 @@ static const char * cover_musicbrainz_url (GlyrQuery * q)
 static GlyrMemCache * parse_web_page (GlyrMemCache * page)
 {
     GlyrMemCache * retv = NULL;
-    if (page && page->data)
+    if (page->data)
     {
         char * begin = strstr (page->data,COVERART);
         if (begin != NULL)
@@ -58,7 +58,6 @@ static GlyrMemCache * parse_web_page (GlyrMemCache * page)
                 }
             }
         }
-        DL_free (page);
     }
     return retv;
 }
@@ -70,13 +69,25 @@ static GlyrMemCache * parse_web_page (GlyrMemCache * page)
 
 /////////////////////////////////
 
-static GList * cover_musicbrainz_parse (cb_object * capo)
+static GList * cover_musicbrainz_parse_page (cb_object * capo, gpointer userptr)
 {
     GList * result_list = NULL;
+    GlyrMemCache * item = parse_web_page (capo->cache);
+    if (item != NULL)
+    {
+        result_list = g_list_prepend (result_list,item);
+    }
+    return result_list;
+}
 
+/////////////////////////////////
+
+static GList * cover_musicbrainz_parse (cb_object * capo)
+{
+    gint scheduled = 0;
     char * node = capo->cache->data;
 
-    while (continue_search (g_list_length (result_list),capo->s) && (node = strstr (node + 1,NODE) ) )
+    while (continue_search (scheduled,capo->s) && (node = strstr (node + 1,NODE) ) )
     {
         char * album  = get_search_value (node,"<title>","</title>");
         char * artist = get_search_value (node,"<name>" ,"</name>" );
@@ -92,11 +103,8 @@ static GList * cover_musicbrainz_parse (cb_object * capo)
                 char * url = g_strdup_printf (DL_URL,ID);
                 if (url != NULL)
                 {
-                    GlyrMemCache * item = parse_web_page (download_single (url,capo->s,NULL) );
-                    if (item != NULL)
-                    {
-                        result_list = g_list_prepend (result_list,item);
-                    }
+                    async_followup (capo,url,cover_musicbrainz_parse_page,NULL,NULL);
+                    scheduled++;
                 }
                 g_free (url);
             }
@@ -105,8 +113,7 @@ static GList * cover_musicbrainz_parse (cb_object * capo)
         g_free (artist);
         g_free (album);
     }
-
-    return result_list;
+    return NULL;
 }
 
 /////////////////////////////////
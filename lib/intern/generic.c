@@ -26,7 +26,6 @@ struct callback_save_struct
 {
     GHashTable * table;
     GLYR_DATA_TYPE type;
-    GList * results;
 };
 
 /////////////////////////////////
@@ -39,7 +38,7 @@ GList * generic_txt_finalizer (GlyrQuery * settings, GList * input_list, gboolea
     for (GList * elem = input_list; elem; elem = elem->next)
     {
         GlyrMemCache * item = elem->data;
-        if (is_in_result_list (item,result_list[0]) == FALSE && add_to_list == TRUE)
+        if (is_in_result_list (item,settings) == FALSE && add_to_list == TRUE)
         {
             /* Set to some default type */
             if (item->type == GLYR_TYPE_UNKNOWN)
@@ -58,6 +57,7 @@ GList * generic_txt_finalizer (GlyrQuery * settings, GList * input_list, gboolea
             if (response != GLYRE_SKIP && response != GLYRE_STOP_PRE)
             {
                 almost_copied = g_list_prepend (almost_copied,item);
+                remember_result (item,settings);
             }
             else
             {
@@ -98,11 +98,30 @@ static GList * async_dl_callback (cb_object * capo, void * userptr, bool * stop_
             GLYR_ERROR response = GLYRE_OK;
             if (old_cache != NULL)
             {
-                update_md5sum (capo->cache);
-                if (is_in_result_list (capo->cache,saver->results) == FALSE)
+                ensure_md5sum (capo->cache);
+
+                /* Unless known before, the format comes from the response's Content-Type */
+                if (old_cache->img_format != NULL)
+                {
+                    g_free (capo->cache->img_format);
+                    capo->cache->img_format = g_strdup (old_cache->img_format);
+                }
+
+                gchar * allowed_formats = capo->s->allowed_formats;
+                if (allowed_formats == NULL)
+                {
+                    allowed_formats = GLYR_DEFAULT_ALLOWED_FORMATS;
+                }
+
+                if (format_is_allowed (capo->cache->img_format,allowed_formats) == FALSE)
+                {
+                    glyr_message (2,capo->s,"glyr: Skipping image of wrong format '%s'\n", (capo->cache->img_format) ? capo->cache->img_format : "unknown");
+                    capo->s->itemctr--;
+                    *add_item = FALSE;
+                }
+                else if (is_in_result_list (capo->cache,capo->s) == FALSE)
                 {
                     capo->cache->prov       = (old_cache->prov!=NULL) ? g_strdup (old_cache->prov) : NULL;
-                    capo->cache->img_format = (old_cache->img_format) ? g_strdup (old_cache->img_format) : NULL;
 
                     if (capo->cache->type == GLYR_TYPE_UNKNOWN)
                     {
@@ -115,6 +134,10 @@ static GList * async_dl_callback (cb_object * capo, void * userptr, bool * stop_
                     }
 
                     *add_item = (response != GLYRE_SKIP && response != GLYRE_STOP_PRE);
+                    if (*add_item)
+                    {
+                        remember_result (capo->cache,capo->s);
+                    }
                 }
                 else
                 {
@@ -178,12 +201,11 @@ GList * generic_img_finalizer (GlyrQuery * s, GList * list, gboolean * stop_me,
         struct callback_save_struct userptr =
         {
             .table = cache_url_table,
-            .type  = type,
-            .results = result_list ? result_list[0] : NULL
+            .type  = type
         };
 
-        /* Download images in parallel */
-        GList * dl_raw_images = async_download (url_list,NULL,s,1, (g_list_length (url_list) /2),async_dl_callback,&userptr,FALSE);
+        /* Download images in parallel, straight to disk if glyr_opt_download_dir() was given */
+        GList * dl_raw_images = async_download_to_dir (url_list,s->download_dir,s,1, (g_list_length (url_list) /2),async_dl_callback,&userptr,FALSE);
 
         /* Default to the given type */
         for (GList * elem = dl_raw_images; elem; elem = elem->next)
@@ -193,6 +215,9 @@ GList * generic_img_finalizer (GlyrQuery * s, GList * list, gboolean * stop_me,
             {
                 item->type = type;
             }
+
+            /* Files of skipped images are removed again, these stay */
+            DL_keep_file (item);
         }
 
         /* Freeing Party */
@@ -32,10 +32,7 @@ static GList * factory (GlyrQuery * s, GList * list, gboolean * stop_me, GList *
         GlyrMemCache * item = elem->data;
         if (item != NULL)
         {
-            gchar * temp = beautify_string (item->data);
-            g_free (item->data);
-            item->data = temp;
-            item->size = (item->data) ? strlen (item->data) : 0;
+            DL_set_data (item,beautify_string (item->data),-1);
         }
     }
 
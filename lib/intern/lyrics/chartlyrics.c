@@ -73,35 +73,31 @@ static GlyrMemCache * get_lyrics_from_results (GlyrQuery * s, const gchar * url)
 static GList * lyrics_chartlyrics_parse (cb_object * capo)
 {
     GList * result_list = NULL;
+    GStringChunk * arena = capo_arena (capo);
     gchar * node = capo->cache->data;
     gint nodelen = (sizeof LYRIC_NODE) - 1;
 
     while (continue_search (g_list_length (result_list),capo->s) && (node = strstr (node + nodelen, LYRIC_NODE) ) != NULL)
     {
         node += nodelen;
-        gchar * artist = get_search_value (node,ARTIST_BEG,ARTIST_END);
-        gchar * title  = get_search_value (node,SONG_BEG,SONG_END);
+        gchar * artist = chunk_get_search_value (arena,node,ARTIST_BEG,ARTIST_END);
+        gchar * title  = chunk_get_search_value (arena,node,SONG_BEG,SONG_END);
 
         if (levenshtein_strnormcmp (capo->s,artist,capo->s->artist) <= capo->s->fuzzyness &&
                 levenshtein_strnormcmp (capo->s,title,capo->s->title)   <= capo->s->fuzzyness)
         {
-            gchar * lyric_id = get_search_value (node,LYRIC_ID_BEG,LYRIC_ID_END);
-            gchar * lyric_checksum = get_search_value (node,LYRIC_CHECKSUM_BEG,LYRIC_CHECKSUM_END);
+            gchar * lyric_id = chunk_get_search_value (arena,node,LYRIC_ID_BEG,LYRIC_ID_END);
+            gchar * lyric_checksum = chunk_get_search_value (arena,node,LYRIC_CHECKSUM_BEG,LYRIC_CHECKSUM_END);
             if (lyric_id && lyric_checksum && strcmp (lyric_id,"0") != 0)
             {
-                gchar * content_url = g_strdup_printf (CL_API_GET,lyric_id,lyric_checksum);
+                gchar * content_url = chunk_printf (arena,CL_API_GET,lyric_id,lyric_checksum);
                 GlyrMemCache * result = get_lyrics_from_results (capo->s,content_url);
                 if (result != NULL)
                 {
                     result_list = g_list_prepend (result_list,result);
                 }
-                g_free (content_url);
             }
-            g_free (lyric_id);
-            g_free (lyric_checksum);
         }
-        g_free (artist);
-        g_free (title);
     }
     return result_list;
 }
@@ -94,9 +94,23 @@ static gboolean validate_track_description (GlyrQuery * query, gchar * descripti
 
 /////////////////////////////////
 
+static GList * parse_followed_lyrics_page (cb_object * capo, gpointer userptr)
+{
+    GList * result_list = NULL;
+    GlyrMemCache * result_cache = parse_lyrics_page (capo->cache);
+    if (result_cache != NULL)
+    {
+        result_list = g_list_prepend (result_list,result_cache);
+    }
+    return result_list;
+}
+
+/////////////////////////////////
+
 static GList * lyrics_lipwalk_parse (cb_object *capo)
 {
     GList * result_list  = NULL;
+    gint scheduled = 0;
     if (strstr (capo->cache->data,IS_ON_SEARCH_PAGE) == NULL)
     {
         GlyrMemCache * result_cache = parse_lyrics_page (capo->cache);
@@ -107,7 +121,7 @@ static GList * lyrics_lipwalk_parse (cb_object *capo)
         /* Happens with "In Flames" - "Trigger" e.g.                          */
         gchar * search_node = capo->cache->data;
         gsize track_len = (sizeof TRACK_BEGIN) - 1;
-        while (continue_search (g_list_length (result_list),capo->s) && (search_node = strstr (search_node + track_len,TRACK_BEGIN) ) )
+        while (continue_search (scheduled,capo->s) && (search_node = strstr (search_node + track_len,TRACK_BEGIN) ) )
         {
             search_node += track_len;
             gchar * track_end = strstr (search_node,TRACK_ENDIN);
@@ -121,19 +135,11 @@ static GList * lyrics_lipwalk_parse (cb_object *capo)
                     if (track_descr != NULL && validate_track_description (capo->s,track_descr) == TRUE)
                     {
                         gchar * full_url = g_strdup_printf ("%s%s",LIPWALK_DOMAIN,lyrics_url);
-                        GlyrMemCache * lyrics_page = download_single (full_url,capo->s,NULL);
-                        if (lyrics_page != NULL)
-                        {
-                            GlyrMemCache * result_cache = parse_lyrics_page (lyrics_page);
-                            if (result_cache != NULL)
-                            {
-                                result_list = g_list_prepend (result_list,result_cache);
-                            }
-                            DL_free (lyrics_page);
-                        }
-                        g_free (track_descr);
+                        async_followup (capo,full_url,parse_followed_lyrics_page,NULL,NULL);
+                        scheduled++;
                         g_free (full_url);
                     }
+                    g_free (track_descr);
                     g_free (lyrics_url);
                 }
             }
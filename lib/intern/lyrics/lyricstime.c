@@ -106,9 +106,22 @@ static gboolean validate_artist (cb_object * capo, gchar * backpointer)
 
 /////////////////////////////////
 
-static GList * lyrics_lyricstime_parse (cb_object * capo)
+static GList * parse_followed_page (cb_object * capo, gpointer userptr)
 {
     GList * rList = NULL;
+    GlyrMemCache * parsed_cache = parse_page (capo->cache,capo);
+    if (parsed_cache != NULL)
+    {
+        rList = g_list_prepend (rList,parsed_cache);
+    }
+    return rList;
+}
+
+/////////////////////////////////
+
+static GList * lyrics_lyricstime_parse (cb_object * capo)
+{
+    gint scheduled = 0;
     char * start = capo->cache->data;
     if (start != NULL)
     {
@@ -117,7 +130,7 @@ static GList * lyrics_lyricstime_parse (cb_object * capo)
         gchar * backpointer = node;
         gsize nlen = (sizeof NODE_BEGIN) - 1;
 
-        while (continue_search (g_list_length (rList),capo->s) && (node = strstr (node+nlen,NODE_BEGIN) ) != NULL)
+        while (continue_search (scheduled,capo->s) && (node = strstr (node+nlen,NODE_BEGIN) ) != NULL)
         {
             if (div_end >= node)
                 break;
@@ -131,17 +144,10 @@ static GList * lyrics_lyricstime_parse (cb_object * capo)
                     if (url != NULL)
                     {
                         gchar * full_url = g_strdup_printf ("http://www.lyricstime.com%s",url);
-                        GlyrMemCache * dl_cache = download_single (full_url,capo->s,NULL);
-                        if (dl_cache)
-                        {
-                            GlyrMemCache * parsed_cache = parse_page (dl_cache,capo);
-                            if (parsed_cache != NULL)
-                            {
-                                rList = g_list_prepend (rList,parsed_cache);
-                            }
-                            DL_free (dl_cache);
-                            g_free (full_url);
-                        }
+                        async_followup (capo,full_url,parse_followed_page,NULL,NULL);
+                        scheduled++;
+
+                        g_free (full_url);
                         g_free (url);
                     }
                 }
@@ -149,7 +155,7 @@ static GList * lyrics_lyricstime_parse (cb_object * capo)
             backpointer = node;
         }
     }
-    return rList;
+    return NULL;
 }
 
 /////////////////////////////////
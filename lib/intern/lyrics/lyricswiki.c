@@ -125,24 +125,26 @@ GList * parse_result_page (GlyrQuery * query, GlyrMemCache * to_parse)
 
 /////////////////////////////////
 
+static GList * lyrics_lyricswiki_parse_page (cb_object * capo, gpointer userptr)
+{
+    return parse_result_page (capo->s,capo->cache);
+}
+
+/////////////////////////////////
+
 static GList * lyrics_lyricswiki_parse (cb_object * capo)
 {
-    GList * result_list = NULL;
     if (strstr (capo->cache->data,NOT_FOUND) == NULL && lv_cmp_content (strstr (capo->cache->data,"<artist>"),strstr (capo->cache->data,"<song>"),capo) )
     {
         gchar * wiki_page_url = get_search_value (capo->cache->data,"<url>","</url>");
         if (wiki_page_url != NULL)
         {
-            GlyrMemCache * new_cache = download_single (wiki_page_url,capo->s,NULL);
-            if (new_cache != NULL)
-            {
-                result_list = parse_result_page (capo->s,new_cache);
-                DL_free (new_cache);
-            }
+            /* The actual lyrics are on the wiki page */
+            async_followup (capo,wiki_page_url,lyrics_lyricswiki_parse_page,NULL,NULL);
             g_free (wiki_page_url);
         }
     }
-    return result_list;
+    return NULL;
 }
 
 /////////////////////////////////
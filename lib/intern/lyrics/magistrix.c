@@ -55,9 +55,22 @@ static GlyrMemCache * parse_lyric_page (GlyrMemCache * cache)
 #define SEARCH_LINK_START "&ndash;\n<a href=\""
 #define SEARCH_LINK_END   "\" class"
 
-static GList * parse_search_result_page (cb_object * capo)
+static GList * parse_followed_lyric_page (cb_object * capo, gpointer userptr)
 {
     GList * result_list = NULL;
+    GlyrMemCache * item = parse_lyric_page (capo->cache);
+    if (item != NULL)
+    {
+        result_list = g_list_prepend (result_list, item);
+    }
+    return result_list;
+}
+
+///////////////////////////////////
+
+static void parse_search_result_page (cb_object * capo)
+{
+    gint scheduled = 0;
     char * first_result = strstr (capo->cache->data, SEARCH_FIRST_RESULT);
     if (first_result != NULL)
     {
@@ -66,29 +79,21 @@ static GList * parse_search_result_page (cb_object * capo)
         {
             char * node = first_result;
             while ( (node = strstr (node + sizeof (SEARCH_NODE), SEARCH_NODE) )
-                    && continue_search (g_list_length (result_list), capo->s) )
+                    && continue_search (scheduled, capo->s) )
             {
                 char * new_url = get_search_value (node, SEARCH_LINK_START, SEARCH_LINK_END);
                 if (new_url != NULL)
                 {
                     char * full_url = g_strdup_printf ("www.magistrix.de%s", new_url);
-                    GlyrMemCache * lyrics_page = download_single (full_url, capo->s, NULL);
-                    if (lyrics_page)
-                    {
-                        GlyrMemCache * item = parse_lyric_page (lyrics_page);
-                        if (item != NULL)
-                        {
-                            result_list = g_list_prepend (result_list, item);
-                        }
-                        DL_free (lyrics_page);
-                    }
+                    async_followup (capo, full_url, parse_followed_lyric_page, NULL, NULL);
+                    scheduled++;
+
                     g_free (new_url);
                     g_free (full_url);
                 }
             }
         }
     }
-    return result_list;
 }
 
 ///////////////////////////////////
@@ -108,8 +113,8 @@ static GList * lyrics_magistrix_parse (cb_object * capo)
         }
         else
         {
-            /* Parse Searchresult page */
-            result_list = parse_search_result_page (capo);
+            /* Parse Searchresult page, lyrics follow later */
+            parse_search_result_page (capo);
         }
     }
     return result_list;
@@ -43,9 +43,20 @@ static const gchar * lyrics_metallum_url (GlyrQuery * s)
 
 /////////////////////////////////
 
-static GList * lyrics_metallum_parse (cb_object * capo)
+static GList * lyrics_metallum_parse_lyrics (cb_object * capo, gpointer userptr)
 {
     GList * result_items = NULL;
+    if (strstr (capo->cache->data,BAD_STRING) == NULL)
+    {
+        result_items = g_list_prepend (result_items, DL_copy (capo->cache) );
+    }
+    return result_items;
+}
+
+/////////////////////////////////
+
+static GList * lyrics_metallum_parse (cb_object * capo)
+{
     gchar * id_start = strstr (capo->cache->data,ID_START);
     if (id_start != NULL)
     {
@@ -56,17 +67,13 @@ static GList * lyrics_metallum_parse (cb_object * capo)
             gchar * content_url = g_strdup_printf (SUBST_URL,ID_string);
             if (content_url != NULL)
             {
-                GlyrMemCache * content_cache = download_single (content_url,capo->s,NULL);
-                if (content_cache != NULL && strstr (content_cache->data,BAD_STRING) == NULL)
-                {
-                    result_items = g_list_prepend (result_items, content_cache);
-                }
+                async_followup (capo,content_url,lyrics_metallum_parse_lyrics,NULL,NULL);
                 g_free (content_url);
             }
             g_free (ID_string);
         }
     }
-    return result_items;
+    return NULL;
 }
 
 /////////////////////////////////
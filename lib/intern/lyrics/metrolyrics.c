@@ -104,6 +104,7 @@ static GlyrMemCache * parse_lyrics_page (const gchar * buffer)
 static GList * lyrics_metrolyrics_parse (cb_object * capo)
 {
     GList * result_list = NULL;
+    GStringChunk * arena = capo_arena (capo);
     gchar * root = strstr (capo->cache->data,ROOT_NODE);
 
     if (root != NULL)
@@ -118,16 +119,16 @@ static GList * lyrics_metrolyrics_parse (cb_object * capo)
         {
             node += nodelen;
 
-            gchar * m_artist = get_search_value (node,"<span class=\"title\">","<br />");
-            gchar * m_title  = get_search_value (node,"<strong>"," Lyrics</strong>");
+            gchar * m_artist = chunk_get_search_value (arena,node,"<span class=\"title\">","<br />");
+            gchar * m_title  = chunk_get_search_value (arena,node,"<strong>"," Lyrics</strong>");
 
             if (levenshtein_strnormcmp (capo->s,capo->s->title, m_title)  <= capo->s->fuzzyness &&
                     levenshtein_strnormcmp (capo->s,capo->s->artist,m_artist) <= capo->s->fuzzyness)
             {
-                gchar * relative_url = copy_value (node, strstr (node,"\">") );
+                gchar * relative_url = chunk_copy_value (arena,node, strstr (node,"\">") );
                 if (relative_url != NULL)
                 {
-                    gchar * page_url = g_strdup_printf ("www.metrolyrics.com/%s",relative_url);
+                    gchar * page_url = chunk_printf (arena,"www.metrolyrics.com/%s",relative_url);
 
                     tries++;
                     GlyrMemCache * page_cache = download_single (page_url,capo->s,NULL);
@@ -142,14 +143,9 @@ static GList * lyrics_metrolyrics_parse (cb_object * capo)
                         }
                         DL_free (page_cache);
                     }
-                    g_free (page_url);
-                    g_free (relative_url);
                 }
             }
 
-            g_free (m_artist);
-            g_free (m_title);
-
             /* Only advertisment behind dist */
             if (node >= end_of_earch) break;
         }
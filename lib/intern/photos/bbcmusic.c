@@ -54,10 +54,21 @@ static const char * photos_bbcmusic_url (GlyrQuery * qry)
 
 /////////////////////////////////
 
-static GList * photos_bbcmusic_parse (cb_object * capo)
+static GList * photos_bbcmusic_parse_xml (cb_object * capo, gpointer userptr)
 {
     GList * result_list = NULL;
+    GlyrMemCache * item = parse_bbc_xml (capo->cache);
+    if (item != NULL)
+    {
+        result_list = g_list_prepend (result_list, item);
+    }
+    return result_list;
+}
 
+/////////////////////////////////
+
+static GList * photos_bbcmusic_parse (cb_object * capo)
+{
     char * mbid = mbid_parse_data (capo->cache, "artist", "name", capo->s->artist, capo->s);
 
     if (mbid != NULL)
@@ -65,22 +76,13 @@ static GList * photos_bbcmusic_parse (cb_object * capo)
         char * full_url = g_strdup_printf (API_ROOT, mbid);
         if (full_url != NULL)
         {
-            GlyrMemCache * bbc_xml = download_single (full_url, capo->s, NULL);
-            if (bbc_xml != NULL)
-            {
-                GlyrMemCache * item = parse_bbc_xml (bbc_xml);
-                if (item != NULL)
-                {
-                    result_list = g_list_prepend (result_list, item);
-                }
-                DL_free(bbc_xml);
-            }
+            async_followup (capo, full_url, photos_bbcmusic_parse_xml, NULL, NULL);
             g_free(full_url);
         }
         g_free(mbid);
     }
 
-    return result_list;
+    return NULL;
 }
 
 /////////////////////////////////
@@ -52,6 +52,7 @@ static const gchar * photos_flickr_url (GlyrQuery * settings)
 static GList * photos_flickr_parse (cb_object * capo)
 {
     gchar * ph_begin = capo->cache->data;
+    GStringChunk * arena = capo_arena (capo);
     GList * result_list = NULL;
 
     while (continue_search (g_list_length (result_list),capo->s) && (ph_begin=strstr (ph_begin,LINE_BEGIN) ) != NULL)
@@ -59,25 +60,18 @@ static GList * photos_flickr_parse (cb_object * capo)
         gchar * ph_end = strstr (ph_begin,LINE_ENDIN);
         if (ph_end != NULL)
         {
-            gchar * linebf = copy_value (ph_begin,ph_end);
+            gchar * linebf = chunk_copy_value (arena,ph_begin,ph_end);
             if (linebf != NULL)
             {
-                gchar * ID = get_search_value (linebf, "id=\"","\"");
-                gchar * SC = get_search_value (linebf, "secret=\"","\"");
-                gchar * SV = get_search_value (linebf, "server=\"","\"");
-                gchar * FR = get_search_value (linebf, "farm=\"","\"");
+                gchar * ID = chunk_get_search_value (arena,linebf, "id=\"","\"");
+                gchar * SC = chunk_get_search_value (arena,linebf, "secret=\"","\"");
+                gchar * SV = chunk_get_search_value (arena,linebf, "server=\"","\"");
+                gchar * FR = chunk_get_search_value (arena,linebf, "farm=\"","\"");
 
                 GlyrMemCache * cache = DL_init();
                 cache->data = g_strdup_printf ("http://farm%s.static.flickr.com/%s/%s_%s.jpg",FR,SV,ID,SC);
                 cache->size = strlen (cache->data);
                 result_list = g_list_prepend (result_list,cache);
-
-                g_free (ID);
-                g_free (SC);
-                g_free (SV);
-                g_free (FR);
-
-                g_free (linebf);
             }
         }
     }
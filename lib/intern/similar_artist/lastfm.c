@@ -46,18 +46,19 @@ static const char * similar_lastfm_url (GlyrQuery * sets)
 static GList * similar_lastfm_parse (cb_object * capo)
 {
     GList * results = NULL;
+    GStringChunk * arena = capo_arena (capo);
     gchar * find = capo->cache->data;
     while (continue_search (g_list_length (results),capo->s) && (find = strstr (find+1, "<artist>") ) != NULL)
     {
-        gchar * name  = get_search_value (find,NAME_BEGIN,NAME_ENDIN);
-        gchar * match = get_search_value (find,MATCH_BEGIN,MATCH_ENDIN);
-        gchar * url   = get_search_value (find,URL_BEGIN,URL_ENDIN);
+        gchar * name  = chunk_get_search_value (arena,find,NAME_BEGIN,NAME_ENDIN);
+        gchar * match = chunk_get_search_value (arena,find,MATCH_BEGIN,MATCH_ENDIN);
+        gchar * url   = chunk_get_search_value (arena,find,URL_BEGIN,URL_ENDIN);
 
-        gchar * img_s = get_search_value (find,IMAGE_S_BEGIN,IMAGE_ENDIN);
-        gchar * img_m = get_search_value (find,IMAGE_M_BEGIN,IMAGE_ENDIN);
-        gchar * img_l = get_search_value (find,IMAGE_L_BEGIN,IMAGE_ENDIN);
-        gchar * img_e = get_search_value (find,IMAGE_E_BEGIN,IMAGE_ENDIN);
-        gchar * img_x = get_search_value (find,IMAGE_X_BEGIN,IMAGE_ENDIN);
+        gchar * img_s = chunk_get_search_value (arena,find,IMAGE_S_BEGIN,IMAGE_ENDIN);
+        gchar * img_m = chunk_get_search_value (arena,find,IMAGE_M_BEGIN,IMAGE_ENDIN);
+        gchar * img_l = chunk_get_search_value (arena,find,IMAGE_L_BEGIN,IMAGE_ENDIN);
+        gchar * img_e = chunk_get_search_value (arena,find,IMAGE_E_BEGIN,IMAGE_ENDIN);
+        gchar * img_x = chunk_get_search_value (arena,find,IMAGE_X_BEGIN,IMAGE_ENDIN);
         gchar * composed = g_strdup_printf ("%s\n%s\n%s\n%s\n%s\n%s\n%s\n%s\n",name,match,url,img_s,img_m,img_l,img_e,img_x);
 
         if (composed != NULL)
@@ -72,15 +73,6 @@ static GList * similar_lastfm_parse (cb_object * capo)
         {
             results = g_list_reverse (results);
         }
-
-        g_free (name);
-        g_free (match);
-        g_free (url);
-        g_free (img_s);
-        g_free (img_m);
-        g_free (img_l);
-        g_free (img_e);
-        g_free (img_x);
     }
     return results;
 }
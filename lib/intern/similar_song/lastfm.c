@@ -41,14 +41,15 @@ static const gchar * similar_song_lastfm_url (GlyrQuery * sets)
 static GList * similar_song_lastfm_parse (cb_object * capo)
 {
     GList * results = NULL;
+    GStringChunk * arena = capo_arena (capo);
     gchar * begin = capo->cache->data;
 
     while (continue_search (g_list_length (results),capo->s) && (begin = strstr (begin, TRACK_BEGIN) ) != NULL)
     {
-        gchar * track  = get_search_value (begin,NAME_BEGIN,NAME_ENDIN);
-        gchar * match  = get_search_value (begin,MATCH_BEGIN,MATCH_ENDIN);
-        gchar * url    = get_search_value (begin,URL_BEGIN,URL_ENDIN);
-        gchar * artist = get_search_value (strstr (begin,ARTIST_BEGIN),NAME_BEGIN,NAME_ENDIN);
+        gchar * track  = chunk_get_search_value (arena,begin,NAME_BEGIN,NAME_ENDIN);
+        gchar * match  = chunk_get_search_value (arena,begin,MATCH_BEGIN,MATCH_ENDIN);
+        gchar * url    = chunk_get_search_value (arena,begin,URL_BEGIN,URL_ENDIN);
+        gchar * artist = chunk_get_search_value (arena,strstr (begin,ARTIST_BEGIN),NAME_BEGIN,NAME_ENDIN);
 
         if (artist && track)
         {
@@ -58,11 +59,6 @@ static GList * similar_song_lastfm_parse (cb_object * capo)
             results = g_list_prepend (results, result);
         }
 
-        g_free (track);
-        g_free (artist);
-        g_free (match);
-        g_free (url);
-
         begin += sizeof (TRACK_BEGIN) - 1;
     }
     return results;
@@ -34,54 +34,58 @@ artist && album          -> album
 
 /////////////////////////////////
 
-/* Wrap around the (a bit more) generic versions */
-static GList * tags_musicbrainz_parse (cb_object * capo)
+/* Called with the info page of one mbid */
+static GList * tags_musicbrainz_parse_info (cb_object * capo, gpointer userptr)
 {
     GList * results = NULL;
-    gint mbid_marker = 0;
-    while (continue_search (g_list_length (results), capo->s) )
-    {
-        GlyrMemCache  * info = generic_musicbrainz_parse (capo,&mbid_marker,"tags");
-        if (info == NULL)
-        {
-            break;
-        }
+    GlyrMemCache * info = capo->cache;
 
-        gint type_num = please_what_type (capo->s);
-        gchar * tag_node = info->data;
-        while ( (tag_node = strstr (tag_node + 1,"<tag") ) )
-        {
-            gchar * tag_begin = strchr (tag_node+1,'>');
-            if (!tag_begin)
-                continue;
+    gint type_num = please_what_type (capo->s);
+    gchar * tag_node = info->data;
+    while ( (tag_node = strstr (tag_node + 1,"<tag") ) )
+    {
+        gchar * tag_begin = strchr (tag_node+1,'>');
+        if (!tag_begin)
+            continue;
 
-            tag_begin++;
-            gchar * tag_endin = strchr (tag_begin,'<');
-            if (!tag_endin)
-                continue;
+        tag_begin++;
+        gchar * tag_endin = strchr (tag_begin,'<');
+        if (!tag_endin)
+            continue;
 
-            gchar * value = copy_value (tag_begin,tag_endin);
-            if (value != NULL)
+        gchar * value = copy_value (tag_begin,tag_endin);
+        if (value != NULL)
+        {
+            if (strlen (value) > 0)
             {
-                if (strlen (value) > 0)
-                {
-                    GlyrMemCache * tmp = DL_init();
-                    tmp->data = value;
-                    tmp->size = tag_endin - tag_begin;
-                    tmp->type = type_num;
-                    tmp->dsrc = g_strdup (info->dsrc);
+                GlyrMemCache * tmp = DL_init();
+                tmp->data = value;
+                tmp->size = tag_endin - tag_begin;
+                tmp->type = type_num;
+                tmp->dsrc = g_strdup (info->dsrc);
 
-                    results = g_list_prepend (results,tmp);
-                }
+                results = g_list_prepend (results,tmp);
+            }
+            else
+            {
+                g_free (value);
             }
         }
-        DL_free (info);
     }
     return results;
 }
 
 /////////////////////////////////
 
+/* Wrap around the (a bit more) generic versions */
+static GList * tags_musicbrainz_parse (cb_object * capo)
+{
+    generic_musicbrainz_followup (capo,"tags",tags_musicbrainz_parse_info);
+    return NULL;
+}
+
+/////////////////////////////////
+
 static const gchar * tags_musicbrainz_url (GlyrQuery * sets)
 {
     return generic_musicbrainz_url (sets);
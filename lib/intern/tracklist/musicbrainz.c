@@ -72,10 +72,15 @@ static GList * traverse_xml (const gchar * data, const gchar * url, cb_object *
 
 /////////////////////////////////
 
-static GList * tracklist_musicbrainz_parse (cb_object * capo)
+static GList * tracklist_musicbrainz_parse_release (cb_object * capo, gpointer userptr)
 {
-    GList * result_list = NULL;
+    return g_list_reverse (traverse_xml (capo->cache->data,capo->url,capo) );
+}
+
+/////////////////////////////////
 
+static GList * tracklist_musicbrainz_parse (cb_object * capo)
+{
     gchar * rel_id_begin = strstr (capo->cache->data,REL_ID_BEGIN);
     if (rel_id_begin != NULL)
     {
@@ -83,21 +88,12 @@ static GList * tracklist_musicbrainz_parse (cb_object * capo)
         if (release_ID != NULL)
         {
             gchar * release_page_info_url = g_strdup_printf (REL_ID_FORM, release_ID);
-            GlyrMemCache * dlData = download_single (release_page_info_url,capo->s,NULL);
-            if (dlData != NULL)
-            {
-                result_list = traverse_xml (dlData->data,capo->url,capo);
-                if (result_list != NULL)
-                {
-                    result_list = g_list_reverse (result_list);
-                }
-                DL_free (dlData);
-            }
+            async_followup (capo,release_page_info_url,tracklist_musicbrainz_parse_release,NULL,NULL);
             g_free (release_page_info_url);
             g_free (release_ID);
         }
     }
-    return result_list;
+    return NULL;
 }
 
 /////////////////////////////////
@@ -0,0 +1,239 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+/* Library wide pool of curl handles.
+ *
+ * All easy handles share one CURLSH, so DNS lookups and TLS sessions
+ * survive a single glyr_get() and are reused by every thread.
+ * Idle easy and multi handles are kept around, so we don't pay their
+ * setup on every download either; open connections live in the
+ * multi handles' connection caches and are reused with them.
+ */
+#include <curl/multi.h>
+
+#include "netpool.h"
+#include "core.h"
+
+/////////////////////////////////
+
+/* Configuration, takes effect on the next netpool_init() */
+static GLYR_SHARE_FLAGS pool_share_flags = GLYR_DEFAULT_SHARE;
+static gint pool_max_idle = GLYR_DEFAULT_POOL_MAX_IDLE;
+
+/* The share object, NULL if nothing is shared */
+static CURLSH * pool_share = NULL;
+
+/* One lock for each kind of shared data */
+static GMutex pool_share_locks[CURL_LOCK_DATA_LAST];
+
+/* Idle handles, protected by pool_lock */
+static GMutex pool_lock;
+static GQueue pool_idle_easy  = G_QUEUE_INIT;
+static GQueue pool_idle_multi = G_QUEUE_INIT;
+
+/////////////////////////////////
+
+static void share_lock_cb (CURL * eh, curl_lock_data data, curl_lock_access access, void * userptr)
+{
+    g_mutex_lock (&pool_share_locks[data]);
+}
+
+/////////////////////////////////
+
+static void share_unlock_cb (CURL * eh, curl_lock_data data, void * userptr)
+{
+    g_mutex_unlock (&pool_share_locks[data]);
+}
+
+/////////////////////////////////
+
+void netpool_configure (GLYR_SHARE_FLAGS share, gint max_idle)
+{
+    pool_share_flags = share;
+    pool_max_idle = MAX (max_idle,0);
+}
+
+/////////////////////////////////
+
+void netpool_init (void)
+{
+    if (pool_share != NULL || pool_share_flags == GLYR_SHARE_NONE)
+    {
+        return;
+    }
+
+    pool_share = curl_share_init();
+    if (pool_share != NULL)
+    {
+        curl_share_setopt (pool_share, CURLSHOPT_LOCKFUNC, share_lock_cb);
+        curl_share_setopt (pool_share, CURLSHOPT_UNLOCKFUNC, share_unlock_cb);
+
+        if (pool_share_flags & GLYR_SHARE_DNS)
+        {
+            curl_share_setopt (pool_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        }
+
+        if (pool_share_flags & GLYR_SHARE_SSL_SESSION)
+        {
+            curl_share_setopt (pool_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+
+#if LIBCURL_VERSION_NUM >= 0x073900
+        /* Sharing the connection cache needs curl >= 7.57; only on request, see GLYR_SHARE_FLAGS */
+        if (pool_share_flags & GLYR_SHARE_CONNECTIONS)
+        {
+            curl_share_setopt (pool_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        }
+#endif
+    }
+}
+
+/////////////////////////////////
+
+void netpool_destroy (void)
+{
+    g_mutex_lock (&pool_lock);
+
+    CURL * eh = NULL;
+    while ( (eh = g_queue_pop_head (&pool_idle_easy) ) != NULL)
+    {
+        curl_easy_cleanup (eh);
+    }
+
+    CURLM * multi = NULL;
+    while ( (multi = g_queue_pop_head (&pool_idle_multi) ) != NULL)
+    {
+        curl_multi_cleanup (multi);
+    }
+
+    g_mutex_unlock (&pool_lock);
+
+    /* All handles using the share should be gone now, see glyr_cleanup() */
+    if (pool_share != NULL)
+    {
+        CURLSHcode result = curl_share_cleanup (pool_share);
+        if (result == CURLSHE_OK)
+        {
+            pool_share = NULL;
+        }
+        else
+        {
+            /* Still in use by somebody: keep it, the next netpool_init() takes it again */
+            glyr_message (-1,NULL,"Warning: cannot close the connection pool: %s\n",curl_share_strerror (result) );
+        }
+    }
+}
+
+/////////////////////////////////
+
+CURL * netpool_easy_acquire (void)
+{
+    g_mutex_lock (&pool_lock);
+    CURL * eh = g_queue_pop_head (&pool_idle_easy);
+    g_mutex_unlock (&pool_lock);
+
+    if (eh == NULL)
+    {
+        eh = curl_easy_init();
+        if (eh != NULL && pool_share != NULL)
+        {
+            curl_easy_setopt (eh, CURLOPT_SHARE, pool_share);
+        }
+    }
+    return eh;
+}
+
+/////////////////////////////////
+
+void netpool_easy_release (CURL * eh)
+{
+    if (eh == NULL)
+    {
+        return;
+    }
+
+    /* Forget all options and cookies, but keep the caches */
+    curl_easy_setopt (eh, CURLOPT_COOKIELIST, "ALL");
+    curl_easy_reset (eh);
+    if (pool_share != NULL)
+    {
+        curl_easy_setopt (eh, CURLOPT_SHARE, pool_share);
+    }
+
+    g_mutex_lock (&pool_lock);
+    if (g_queue_get_length (&pool_idle_easy) < (guint) pool_max_idle)
+    {
+        g_queue_push_head (&pool_idle_easy,eh);
+        eh = NULL;
+    }
+    g_mutex_unlock (&pool_lock);
+
+    /* Pool is full */
+    if (eh != NULL)
+    {
+        curl_easy_cleanup (eh);
+    }
+}
+
+/////////////////////////////////
+
+CURLM * netpool_multi_acquire (void)
+{
+    g_mutex_lock (&pool_lock);
+    CURLM * multi = g_queue_pop_head (&pool_idle_multi);
+    g_mutex_unlock (&pool_lock);
+
+    if (multi == NULL)
+    {
+        multi = curl_multi_init();
+    }
+    return multi;
+}
+
+/////////////////////////////////
+
+void netpool_multi_release (CURLM * multi)
+{
+    if (multi == NULL)
+    {
+        return;
+    }
+
+    /* The callbacks point to the engine, which is gone now */
+    curl_multi_setopt (multi, CURLMOPT_SOCKETFUNCTION, NULL);
+    curl_multi_setopt (multi, CURLMOPT_SOCKETDATA, NULL);
+    curl_multi_setopt (multi, CURLMOPT_TIMERFUNCTION, NULL);
+    curl_multi_setopt (multi, CURLMOPT_TIMERDATA, NULL);
+
+    g_mutex_lock (&pool_lock);
+    if (g_queue_get_length (&pool_idle_multi) < (guint) pool_max_idle)
+    {
+        g_queue_push_head (&pool_idle_multi,multi);
+        multi = NULL;
+    }
+    g_mutex_unlock (&pool_lock);
+
+    if (multi != NULL)
+    {
+        curl_multi_cleanup (multi);
+    }
+}
+
+/////////////////////////////////
@@ -0,0 +1,39 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+#ifndef GLYR_NETPOOL_H
+#define GLYR_NETPOOL_H
+
+#include <glib.h>
+#include <curl/curl.h>
+
+#include "types.h"
+
+void netpool_configure (GLYR_SHARE_FLAGS share, gint max_idle);
+void netpool_init (void);
+void netpool_destroy (void);
+
+CURL * netpool_easy_acquire (void);
+void netpool_easy_release (CURL * eh);
+
+CURLM * netpool_multi_acquire (void);
+void netpool_multi_release (CURLM * multi);
+
+#endif
@@ -0,0 +1,329 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+/* Running statistics about every provider, collected by the engine.
+ *
+ * The quality and speed constants in each MetaDataSource are only
+ * a first guess; once a provider has been used a few times its
+ * observed latency, success rate and useful-result rate take over,
+ * so dead or slow providers sink in get_queued()'s ranking.
+ * Statistics are kept for the lifetime of the process and may be
+ * persisted in a GlyrDatabase, see cache_intern.c.
+ *
+ * Every provider also has a circuit breaker: after a few connect or
+ * timeout failures in a row it is not asked anymore until its
+ * cool-down ran out, then a single probe query is let through.
+ * A good probe closes the breaker, a failed one doubles the cool-down.
+ */
+#include <stdlib.h>
+
+#include "provstats.h"
+
+/////////////////////////////////
+
+/* MetaDataSource * -> ProviderStats *, protected by stats_lock */
+static GHashTable * stats_table = NULL;
+static GMutex stats_lock;
+
+/////////////////////////////////
+
+/* Needs stats_lock */
+static ProviderStats * lookup_stats (MetaDataSource * src, gboolean create)
+{
+    ProviderStats * stats = NULL;
+    if (stats_table != NULL && src != NULL)
+    {
+        stats = g_hash_table_lookup (stats_table,src);
+        if (stats == NULL && create)
+        {
+            stats = g_malloc0 (sizeof (ProviderStats) );
+            stats->success_rate = 1.0;
+            stats->useful_rate  = 1.0;
+            g_hash_table_insert (stats_table,src,stats);
+        }
+    }
+    return stats;
+}
+
+/////////////////////////////////
+
+static gint compare_floats (gconstpointer a, gconstpointer b)
+{
+    gfloat fa = * (const gfloat *) a;
+    gfloat fb = * (const gfloat *) b;
+    return (fa > fb) - (fa < fb);
+}
+
+/////////////////////////////////
+
+void provstats_init (void)
+{
+    g_mutex_lock (&stats_lock);
+    if (stats_table == NULL)
+    {
+        stats_table = g_hash_table_new_full (g_direct_hash,g_direct_equal,NULL,g_free);
+    }
+    g_mutex_unlock (&stats_lock);
+}
+
+/////////////////////////////////
+
+void provstats_destroy (void)
+{
+    g_mutex_lock (&stats_lock);
+    if (stats_table != NULL)
+    {
+        g_hash_table_destroy (stats_table);
+        stats_table = NULL;
+    }
+    g_mutex_unlock (&stats_lock);
+}
+
+/////////////////////////////////
+
+/* Only failures that hint at a dead host count for the breaker,
+ * a 404 or a broken page still means somebody is answering.
+ */
+static gboolean is_outage (CURLcode result)
+{
+    switch (result)
+    {
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_GOT_NOTHING:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/////////////////////////////////
+
+/* Needs stats_lock */
+static void update_breaker (ProviderStats * stats, CURLcode result)
+{
+    if (is_outage (result) == FALSE)
+    {
+        stats->failures_in_row = 0;
+        stats->cooldown = 0;
+        stats->open_until = 0;
+        return;
+    }
+
+    if (++stats->failures_in_row >= PROVSTATS_BREAKER_THRESHOLD)
+    {
+        if (stats->cooldown == 0)
+        {
+            stats->cooldown = PROVSTATS_COOLDOWN_MIN;
+        }
+        else if (stats->failures_in_row > PROVSTATS_BREAKER_THRESHOLD)
+        {
+            /* The probe failed too */
+            stats->cooldown = MIN (stats->cooldown * 2,PROVSTATS_COOLDOWN_MAX);
+        }
+        stats->open_until = g_get_monotonic_time() + (gint64) stats->cooldown * G_USEC_PER_SEC;
+    }
+}
+
+/////////////////////////////////
+
+/* A transfer of src finished, successful or not */
+void provstats_record_transfer (MetaDataSource * src, CURLcode result, gdouble latency_ms)
+{
+    g_mutex_lock (&stats_lock);
+    ProviderStats * stats = lookup_stats (src,TRUE);
+    if (stats != NULL)
+    {
+        gboolean success = (result == CURLE_OK);
+        update_breaker (stats,result);
+
+        stats->samples++;
+        stats->success_rate += PROVSTATS_DECAY * ( (success ? 1.0 : 0.0) - stats->success_rate);
+
+        /* Failed transfers usually ran into a timeout, that's worth remembering too */
+        stats->latency[stats->latency_next] = latency_ms;
+        stats->latency_next = (stats->latency_next + 1) % PROVSTATS_WINDOW;
+        stats->latency_count = MIN (stats->latency_count + 1, PROVSTATS_WINDOW);
+        stats->dirty = TRUE;
+    }
+    g_mutex_unlock (&stats_lock);
+}
+
+/////////////////////////////////
+
+/* A successful transfer of src was parsed; did it yield anything? */
+void provstats_record_result (MetaDataSource * src, gboolean useful)
+{
+    g_mutex_lock (&stats_lock);
+    ProviderStats * stats = lookup_stats (src,TRUE);
+    if (stats != NULL)
+    {
+        stats->useful_rate += PROVSTATS_DECAY * ( (useful ? 1.0 : 0.0) - stats->useful_rate);
+        stats->dirty = TRUE;
+    }
+    g_mutex_unlock (&stats_lock);
+}
+
+/////////////////////////////////
+
+/* Copy the statistics of src, FALSE if there are none yet */
+gboolean provstats_get (MetaDataSource * src, ProviderStats * copy)
+{
+    gboolean found = FALSE;
+    g_mutex_lock (&stats_lock);
+    ProviderStats * stats = lookup_stats (src,FALSE);
+    if (stats != NULL && copy != NULL)
+    {
+        *copy = *stats;
+        found = TRUE;
+    }
+    g_mutex_unlock (&stats_lock);
+    return found;
+}
+
+/////////////////////////////////
+
+/* Like provstats_get(), but only if src changed since the last call; marks it as seen */
+gboolean provstats_take_changed (MetaDataSource * src, ProviderStats * copy)
+{
+    gboolean changed = FALSE;
+    g_mutex_lock (&stats_lock);
+    ProviderStats * stats = lookup_stats (src,FALSE);
+    if (stats != NULL && stats->dirty == TRUE && copy != NULL)
+    {
+        stats->dirty = FALSE;
+        *copy = *stats;
+        changed = TRUE;
+    }
+    g_mutex_unlock (&stats_lock);
+    return changed;
+}
+
+/////////////////////////////////
+
+/* Restore previously saved statistics, unless there are newer ones already */
+void provstats_set (MetaDataSource * src, const ProviderStats * saved)
+{
+    g_mutex_lock (&stats_lock);
+    if (saved != NULL && lookup_stats (src,FALSE) == NULL)
+    {
+        ProviderStats * stats = lookup_stats (src,TRUE);
+        if (stats != NULL)
+        {
+            *stats = *saved;
+            stats->dirty = FALSE;
+            stats->latency_count = MIN (stats->latency_count, PROVSTATS_WINDOW);
+            stats->latency_next  = stats->latency_next % PROVSTATS_WINDOW;
+        }
+    }
+    g_mutex_unlock (&stats_lock);
+}
+
+/////////////////////////////////
+
+/* percentile in [0.0,1.0]; -1 if no latency is known */
+gdouble provstats_latency_percentile (const ProviderStats * stats, gdouble percentile)
+{
+    if (stats == NULL || stats->latency_count == 0)
+    {
+        return -1;
+    }
+
+    gfloat sorted[PROVSTATS_WINDOW];
+    memcpy (sorted,stats->latency,stats->latency_count * sizeof (gfloat) );
+    qsort (sorted,stats->latency_count,sizeof (gfloat),compare_floats);
+
+    guint index = CLAMP (percentile,0.0,1.0) * (stats->latency_count - 1) + 0.5;
+    return sorted[index];
+}
+
+/////////////////////////////////
+
+/* May src be asked? FALSE while its breaker is open.
+ * Once the cool-down ran out exactly one caller gets TRUE (the probe),
+ * everybody else waits for another cool-down or for the probe to succeed.
+ */
+gboolean provstats_allow (MetaDataSource * src)
+{
+    gboolean allowed = TRUE;
+    g_mutex_lock (&stats_lock);
+    ProviderStats * stats = lookup_stats (src,FALSE);
+    if (stats != NULL && stats->cooldown != 0)
+    {
+        gint64 now = g_get_monotonic_time();
+        if (now < stats->open_until)
+        {
+            allowed = FALSE;
+        }
+        else
+        {
+            /* Re-arm, so a lost probe does not lock the provider out forever */
+            stats->open_until = now + (gint64) stats->cooldown * G_USEC_PER_SEC;
+        }
+    }
+    g_mutex_unlock (&stats_lock);
+    return allowed;
+}
+
+/////////////////////////////////
+
+/* Seconds until the next probe, 0 if the breaker is closed or a probe is due */
+gint provstats_retry_in (const ProviderStats * stats)
+{
+    gint retry_in = 0;
+    if (stats != NULL && stats->cooldown != 0)
+    {
+        gint64 left = stats->open_until - g_get_monotonic_time();
+        if (left > 0)
+        {
+            retry_in = (left + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC;
+        }
+    }
+    return retry_in;
+}
+
+/////////////////////////////////
+
+/* Blend the static quality and speed of src with what was observed.
+ * timeout (in seconds) is what a latency is compared against.
+ */
+void provstats_adjust_rating (MetaDataSource * src, gint timeout, gint * quality, gint * speed)
+{
+    ProviderStats stats;
+    if (provstats_get (src,&stats) == FALSE || stats.samples == 0)
+    {
+        return;
+    }
+
+    gdouble weight = (gdouble) stats.samples / (stats.samples + PROVSTATS_PRIOR_WEIGHT);
+
+    /* Rate the slow end, a provider is as good as its p90 latency */
+    gdouble p90 = provstats_latency_percentile (&stats,0.9);
+    gdouble budget_ms = MAX (timeout,1) * 1000.0;
+    gdouble observed_speed = (p90 < 0) ? *speed : 100.0 * CLAMP (1.0 - p90 / budget_ms,0.0,1.0);
+    observed_speed *= stats.success_rate;
+
+    gdouble observed_quality = 100.0 * stats.useful_rate * stats.success_rate;
+
+    *speed   = (1.0 - weight) * (*speed)   + weight * observed_speed;
+    *quality = (1.0 - weight) * (*quality) + weight * observed_quality;
+}
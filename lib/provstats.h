@@ -0,0 +1,75 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+#ifndef GLYR_PROVSTATS_H
+#define GLYR_PROVSTATS_H
+
+#include "core.h"
+
+/* Number of latencies remembered per provider */
+#define PROVSTATS_WINDOW 32
+
+/* Below this many samples the static quality/speed still dominate */
+#define PROVSTATS_PRIOR_WEIGHT 10
+
+/* Weight of a new sample in the running rates */
+#define PROVSTATS_DECAY 0.2
+
+/* Consecutive connect/timeout failures that take a provider offline */
+#define PROVSTATS_BREAKER_THRESHOLD 3
+
+/* Cool-down in seconds after the breaker opened; doubled on every failed probe */
+#define PROVSTATS_COOLDOWN_MIN 30
+#define PROVSTATS_COOLDOWN_MAX 600
+
+typedef struct
+{
+    guint samples;        /* Finished transfers seen               */
+    gdouble success_rate; /* Running rate of successful transfers  */
+    gdouble useful_rate;  /* Running rate of transfers with result */
+
+    gfloat latency[PROVSTATS_WINDOW]; /* Last latencies in ms, ring buffer */
+    guint latency_count;
+    guint latency_next;
+
+    guint failures_in_row; /* Connect or timeout failures since the last good transfer */
+    gint cooldown;         /* Current cool-down in seconds, 0 while the breaker is closed */
+    gint64 open_until;     /* Monotonic time (µs) the next probe is allowed at */
+
+    gboolean dirty;        /* Changed since provstats_take_changed() saw it last */
+
+} ProviderStats;
+
+void provstats_init (void);
+void provstats_destroy (void);
+
+void provstats_record_transfer (MetaDataSource * src, CURLcode result, gdouble latency_ms);
+void provstats_record_result (MetaDataSource * src, gboolean useful);
+
+gboolean provstats_get (MetaDataSource * src, ProviderStats * copy);
+gboolean provstats_take_changed (MetaDataSource * src, ProviderStats * copy);
+void provstats_set (MetaDataSource * src, const ProviderStats * stats);
+gdouble provstats_latency_percentile (const ProviderStats * stats, gdouble percentile);
+
+gboolean provstats_allow (MetaDataSource * src);
+gint provstats_retry_in (const ProviderStats * stats);
+
+void provstats_adjust_rating (MetaDataSource * src, gint timeout, gint * quality, gint * speed);
+
+#endif
@@ -21,6 +21,7 @@
 /* register all plugins here */
 #include "core.h"
 #include "register_plugins.h"
+#include "provstats.h"
 
 /* Warning: All functions in here are _not_ threadsafe. */
 static void get_list_from_type (MetaDataFetcher * fetch);
@@ -357,6 +358,14 @@ GlyrFetcherInfo * get_plugin_info (void)
                 sinfos->lang_aware = source->lang_aware;
                 sinfos->name    = g_strdup (source->name);
 
+                /* State of the provider's circuit breaker */
+                ProviderStats stats;
+                if (provstats_get (source,&stats) == TRUE)
+                {
+                    sinfos->failures = stats.failures_in_row;
+                    sinfos->retry_in = provstats_retry_in (&stats);
+                }
+
                 if (prev_source != NULL)
                 {
                     prev_source->next = sinfos;
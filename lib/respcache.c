@@ -0,0 +1,266 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+/* Bounded in-memory cache of HTTP responses, keyed by the prepared URL.
+ *
+ * Search endpoints get the very same URLs over and over. Responses
+ * younger than max_age are served without touching the network, older
+ * ones are revalidated with If-None-Match / If-Modified-Since and only
+ * downloaded again if the server says they changed. The least recently
+ * used responses are dropped once max_bytes are used.
+ * The cache is process wide and off unless glyr_response_cache_configure()
+ * gave it some memory.
+ */
+#include "respcache.h"
+
+/////////////////////////////////
+
+typedef struct
+{
+    gchar * url;
+    GlyrMemCache * body; /* Shares its data with the caches handed out */
+    gchar * etag;
+    gchar * last_modified;
+    gint64 stored_at;  /* Monotonic time of the last download or revalidation */
+    GList * link;      /* Position in cache_lru, most recent first */
+} RespCacheEntry;
+
+/////////////////////////////////
+
+/* url -> RespCacheEntry *, all protected by cache_lock */
+static GHashTable * cache_table = NULL;
+static GQueue cache_lru = G_QUEUE_INIT;
+static GMutex cache_lock;
+
+static gsize cache_max_bytes = GLYR_DEFAULT_RESPONSE_CACHE_SIZE;
+static gint cache_max_age = GLYR_DEFAULT_RESPONSE_CACHE_AGE;
+static gsize cache_bytes = 0;
+
+static GlyrResponseCacheStats cache_stats;
+
+/////////////////////////////////
+
+static void entry_free (RespCacheEntry * entry)
+{
+    g_free (entry->url);
+    DL_free (entry->body);
+    g_free (entry->etag);
+    g_free (entry->last_modified);
+    g_free (entry);
+}
+
+/////////////////////////////////
+
+/* Needs cache_lock */
+static void entry_remove (RespCacheEntry * entry)
+{
+    cache_bytes -= entry->body->size;
+    g_queue_delete_link (&cache_lru,entry->link);
+    g_hash_table_remove (cache_table,entry->url);
+    entry_free (entry);
+}
+
+/////////////////////////////////
+
+/* Needs cache_lock */
+static void evict (void)
+{
+    while (cache_bytes > cache_max_bytes && cache_lru.tail != NULL)
+    {
+        entry_remove (cache_lru.tail->data);
+    }
+}
+
+/////////////////////////////////
+
+/* Needs cache_lock */
+static void touch (RespCacheEntry * entry)
+{
+    g_queue_unlink (&cache_lru,entry->link);
+    g_queue_push_head_link (&cache_lru,entry->link);
+}
+
+/////////////////////////////////
+
+static GlyrMemCache * entry_to_cache (RespCacheEntry * entry)
+{
+    return DL_copy (entry->body);
+}
+
+/////////////////////////////////
+
+void respcache_init (void)
+{
+    g_mutex_lock (&cache_lock);
+    if (cache_table == NULL)
+    {
+        cache_table = g_hash_table_new (g_str_hash,g_str_equal);
+        memset (&cache_stats,0,sizeof (cache_stats) );
+    }
+    g_mutex_unlock (&cache_lock);
+}
+
+/////////////////////////////////
+
+void respcache_destroy (void)
+{
+    g_mutex_lock (&cache_lock);
+    if (cache_table != NULL)
+    {
+        g_queue_foreach (&cache_lru, (GFunc) entry_free,NULL);
+        g_queue_clear (&cache_lru);
+        g_hash_table_destroy (cache_table);
+        cache_table = NULL;
+        cache_bytes = 0;
+    }
+    g_mutex_unlock (&cache_lock);
+}
+
+/////////////////////////////////
+
+/* max_bytes of 0 disables and empties the cache */
+void respcache_configure (gsize max_bytes, gint max_age)
+{
+    g_mutex_lock (&cache_lock);
+    cache_max_bytes = max_bytes;
+    cache_max_age = MAX (max_age,0);
+    if (cache_table != NULL)
+    {
+        evict();
+    }
+    g_mutex_unlock (&cache_lock);
+}
+
+/////////////////////////////////
+
+/* FRESH: *body is a copy of the stored response.
+ * STALE: *headers are the conditional request headers to send.
+ */
+RespCacheLookup respcache_lookup (const gchar * url, GlyrMemCache ** body, struct curl_slist ** headers)
+{
+    RespCacheLookup result = RESPCACHE_MISS;
+    g_mutex_lock (&cache_lock);
+    if (cache_table != NULL && cache_max_bytes > 0 && url != NULL)
+    {
+        RespCacheEntry * entry = g_hash_table_lookup (cache_table,url);
+        if (entry == NULL)
+        {
+            cache_stats.misses++;
+        }
+        else if (g_get_monotonic_time() - entry->stored_at < (gint64) cache_max_age * G_USEC_PER_SEC)
+        {
+            touch (entry);
+            *body = entry_to_cache (entry);
+            cache_stats.hits++;
+            result = RESPCACHE_FRESH;
+        }
+        else if (entry->etag != NULL || entry->last_modified != NULL)
+        {
+            gchar * line = NULL;
+            if (entry->etag != NULL)
+            {
+                line = g_strdup_printf ("If-None-Match: %s",entry->etag);
+                *headers = curl_slist_append (*headers,line);
+                g_free (line);
+            }
+            if (entry->last_modified != NULL)
+            {
+                line = g_strdup_printf ("If-Modified-Since: %s",entry->last_modified);
+                *headers = curl_slist_append (*headers,line);
+                g_free (line);
+            }
+            result = RESPCACHE_STALE;
+        }
+        else
+        {
+            /* Nothing to revalidate with */
+            entry_remove (entry);
+            cache_stats.misses++;
+        }
+    }
+    g_mutex_unlock (&cache_lock);
+    return result;
+}
+
+/////////////////////////////////
+
+/* A complete 200 response for url came in */
+void respcache_store (const gchar * url, GlyrMemCache * body, const gchar * etag, const gchar * last_modified)
+{
+    if (url == NULL || body == NULL || body->data == NULL)
+    {
+        return;
+    }
+
+    g_mutex_lock (&cache_lock);
+    if (cache_table != NULL && cache_max_bytes > 0 && body->size <= cache_max_bytes / RESPCACHE_MAX_ENTRY_SHARE)
+    {
+        RespCacheEntry * old = g_hash_table_lookup (cache_table,url);
+        if (old != NULL)
+        {
+            entry_remove (old);
+        }
+
+        RespCacheEntry * entry = g_malloc0 (sizeof (RespCacheEntry) );
+        entry->url = g_strdup (url);
+        entry->body = DL_copy (body);
+        entry->etag = g_strdup (etag);
+        entry->last_modified = g_strdup (last_modified);
+        entry->stored_at = g_get_monotonic_time();
+
+        g_queue_push_head (&cache_lru,entry);
+        entry->link = cache_lru.head;
+        g_hash_table_insert (cache_table,entry->url,entry);
+
+        cache_bytes += entry->body->size;
+        evict();
+    }
+    g_mutex_unlock (&cache_lock);
+}
+
+/////////////////////////////////
+
+/* Server answered 304 Not Modified: the stored body is good for another max_age */
+GlyrMemCache * respcache_revalidated (const gchar * url)
+{
+    GlyrMemCache * body = NULL;
+    g_mutex_lock (&cache_lock);
+    RespCacheEntry * entry = (cache_table && url) ? g_hash_table_lookup (cache_table,url) : NULL;
+    if (entry != NULL)
+    {
+        entry->stored_at = g_get_monotonic_time();
+        touch (entry);
+        body = entry_to_cache (entry);
+        cache_stats.revalidated++;
+    }
+    g_mutex_unlock (&cache_lock);
+    return body;
+}
+
+/////////////////////////////////
+
+void respcache_get_stats (GlyrResponseCacheStats * stats)
+{
+    g_mutex_lock (&cache_lock);
+    *stats = cache_stats;
+    stats->entries = cache_lru.length;
+    stats->bytes = cache_bytes;
+    g_mutex_unlock (&cache_lock);
+}
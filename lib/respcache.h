@@ -0,0 +1,44 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+#ifndef GLYR_RESPCACHE_H
+#define GLYR_RESPCACHE_H
+
+#include "core.h"
+
+/* A single response may use at most this fraction of the cache */
+#define RESPCACHE_MAX_ENTRY_SHARE 4
+
+typedef enum
+{
+    RESPCACHE_MISS,   /* Nothing stored, download as usual              */
+    RESPCACHE_FRESH,  /* Served from memory, no download needed         */
+    RESPCACHE_STALE   /* Stored but old; download with the given headers */
+} RespCacheLookup;
+
+void respcache_init (void);
+void respcache_destroy (void);
+void respcache_configure (gsize max_bytes, gint max_age);
+
+RespCacheLookup respcache_lookup (const gchar * url, GlyrMemCache ** body, struct curl_slist ** headers);
+void respcache_store (const gchar * url, GlyrMemCache * body, const gchar * etag, const gchar * last_modified);
+GlyrMemCache * respcache_revalidated (const gchar * url);
+void respcache_get_stats (GlyrResponseCacheStats * stats);
+
+#endif
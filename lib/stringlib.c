@@ -1151,6 +1151,73 @@ gchar * get_search_value (gchar * ref, gchar * name, gchar * end_string)
 
 ///////////////////////////////////////
 
+/* Arena versions of the above: Parsers throw most of their strings
+ * away right after comparing them, so they're taken from a GStringChunk
+ * and released together with it instead of being g_free'd one by one.
+ */
+gchar * chunk_copy_value (GStringChunk * chunk, const gchar * begin, const gchar * end)
+{
+    if (chunk && begin && end && end >= begin)
+    {
+        /* copy_value() stops at a NUL too */
+        gsize length = end - begin;
+        const gchar * nul = memchr (begin,0,length);
+        return g_string_chunk_insert_len (chunk,begin, (nul) ? nul - begin : (gssize) length);
+    }
+    return NULL;
+}
+
+///////////////////////////////////////
+
+gchar * chunk_get_search_value (GStringChunk * chunk, gchar * ref, gchar * name, gchar * end_string)
+{
+    gchar * result = NULL;
+    if (ref && name)
+    {
+        gchar * begin = strstr (ref,name);
+        if (begin != NULL)
+        {
+            begin += strlen (name);
+            result = chunk_copy_value (chunk,begin,strstr (begin,end_string) );
+        }
+    }
+    return result;
+}
+
+///////////////////////////////////////
+
+gchar * chunk_printf (GStringChunk * chunk, const gchar * format, ...)
+{
+    gchar * result = NULL;
+    if (chunk && format)
+    {
+        /* Most strings fit here, so there's no malloc at all */
+        gchar stack_buf[256];
+        va_list params;
+
+        va_start (params,format);
+        gint written = g_vsnprintf (stack_buf,sizeof (stack_buf),format,params);
+        va_end (params);
+
+        if (written >= 0 && (gsize) written < sizeof (stack_buf) )
+        {
+            result = g_string_chunk_insert_len (chunk,stack_buf,written);
+        }
+        else if (written >= 0)
+        {
+            va_start (params,format);
+            gchar * heap_buf = g_strdup_vprintf (format,params);
+            va_end (params);
+
+            result = g_string_chunk_insert_len (chunk,heap_buf,written);
+            g_free (heap_buf);
+        }
+    }
+    return result;
+}
+
+///////////////////////////////////////
+
 /* Note: Not case-sens: Ä -> a! */
 const gchar * const umlaut_table[][2] =
 {
@@ -86,6 +86,12 @@ gchar * prepare_string (const gchar * input, GLYR_NORMALIZATION mode, gboolean d
 /* Search for name in ref, ending with end_string and return it */
 gchar * get_search_value (gchar * ref, gchar * name, gchar * end_string);
 
+/* Same as copy_value(), get_search_value() and g_strdup_printf(), but allocated from chunk.
+ * The strings live as long as the chunk does, never g_free() them. */
+gchar * chunk_copy_value (GStringChunk * chunk, const gchar * begin, const gchar * end);
+gchar * chunk_get_search_value (GStringChunk * chunk, gchar * ref, gchar * name, gchar * end_string);
+gchar * chunk_printf (GStringChunk * chunk, const gchar * format, ...);
+
 /* Sed. */
 gchar * regex_replace_by_table (const gchar * string, const gchar * const delete_string[][2], gsize string_size);
 
@@ -0,0 +1,132 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+/* Where does the time of a query go? DNS, TLS, the server, or our parsers.
+ *
+ * With glyr_opt_trace() every transfer of a query leaves a GlyrTransferTrace
+ * in the query, most recent first. libcurl's timings are copied as they are,
+ * the CPU time of the parser is filled in by the download loop.
+ */
+#include <time.h>
+
+#include "trace.h"
+
+/////////////////////////////////
+
+static GlyrTransferTrace * trace_new (GlyrQuery * s, const gchar * url)
+{
+    if (s == NULL || s->trace == FALSE)
+    {
+        return NULL;
+    }
+
+    GlyrTransferTrace * trace = g_malloc0 (sizeof (GlyrTransferTrace) );
+    trace->url = g_strdup (url);
+    trace->next = s->trace_head;
+    s->trace_head = trace;
+    return trace;
+}
+
+/////////////////////////////////
+
+static gdouble trace_info_ms (CURL * handle, CURLINFO info)
+{
+    gdouble seconds = 0;
+    curl_easy_getinfo (handle, info, &seconds);
+    return seconds * 1000.0;
+}
+
+/////////////////////////////////
+
+GlyrTransferTrace * trace_transfer (GlyrQuery * s, CURL * handle, const gchar * url, CURLcode result)
+{
+    GlyrTransferTrace * trace = trace_new (s,url);
+    if (trace != NULL && handle != NULL)
+    {
+        trace->result = result;
+        trace->namelookup = trace_info_ms (handle, CURLINFO_NAMELOOKUP_TIME);
+        trace->connect = trace_info_ms (handle, CURLINFO_CONNECT_TIME);
+        trace->appconnect = trace_info_ms (handle, CURLINFO_APPCONNECT_TIME);
+        trace->starttransfer = trace_info_ms (handle, CURLINFO_STARTTRANSFER_TIME);
+        trace->total = trace_info_ms (handle, CURLINFO_TOTAL_TIME);
+
+#if LIBCURL_VERSION_NUM >= 0x073700
+        curl_off_t bytes = 0;
+        curl_easy_getinfo (handle, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+        trace->bytes = bytes;
+#else
+        gdouble bytes = 0;
+        curl_easy_getinfo (handle, CURLINFO_SIZE_DOWNLOAD, &bytes);
+        trace->bytes = bytes;
+#endif
+    }
+    return trace;
+}
+
+/////////////////////////////////
+
+GlyrTransferTrace * trace_cache_hit (GlyrQuery * s, const gchar * url)
+{
+    GlyrTransferTrace * trace = trace_new (s,url);
+    if (trace != NULL)
+    {
+        trace->cached = true;
+    }
+    return trace;
+}
+
+/////////////////////////////////
+
+void trace_set_provider (GlyrTransferTrace * trace, const gchar * provider)
+{
+    if (trace != NULL && trace->provider == NULL)
+    {
+        trace->provider = g_strdup (provider);
+    }
+}
+
+/////////////////////////////////
+
+void trace_free (GlyrTransferTrace * head)
+{
+    while (head != NULL)
+    {
+        GlyrTransferTrace * next = head->next;
+        g_free (head->url);
+        g_free (head->provider);
+        g_free (head);
+        head = next;
+    }
+}
+
+/////////////////////////////////
+
+gdouble trace_thread_time (void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec now;
+    if (clock_gettime (CLOCK_THREAD_CPUTIME_ID,&now) == 0)
+    {
+        return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+    }
+#endif
+    /* Wall clock is the next best thing */
+    return g_get_monotonic_time() / 1000.0;
+}
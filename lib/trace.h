@@ -0,0 +1,34 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a commnadline tool and library to download various sort of musicrelated metadata.
+ * + Copyright (C) [2011]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+#ifndef GLYR_TRACE_H
+#define GLYR_TRACE_H
+
+#include "core.h"
+
+/* Timing of each transfer of a query, see glyr_opt_trace() */
+GlyrTransferTrace * trace_transfer (GlyrQuery * s, CURL * handle, const gchar * url, CURLcode result);
+GlyrTransferTrace * trace_cache_hit (GlyrQuery * s, const gchar * url);
+void trace_set_provider (GlyrTransferTrace * trace, const gchar * provider);
+void trace_free (GlyrTransferTrace * head);
+
+/* CPU time (ms) the calling thread used so far */
+gdouble trace_thread_time (void);
+
+#endif
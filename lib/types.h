@@ -62,10 +62,25 @@ extern "C"
 #define GLYR_DEFAULT_FORCE_UTF8 false
 #define GLYR_DEFAULT_DB_AUTOWRITE true
 #define GLYR_DEFAULT_DB_AUTOREAD true
+#define GLYR_DEFAULT_DB_NEGATIVE_TTL 86400
 #define GLYR_DEFAULT_MUISCTREE_PATH NULL
 #define GLYR_DEFAULT_SUPPORTED_LANGS "en;de;fr;es;it;jp;pl;pt;ru;sv;tr;zh"
 #define GLYR_DEFAULT_LANG_AWARE_ONLY false
 #define GLYR_DEFAULT_NORMALIZATION GLYR_NORMALIZE_MODERATE
+#define GLYR_DEFAULT_SHARE GLYR_SHARE_ALL
+#define GLYR_DEFAULT_POOL_MAX_IDLE 32
+#define GLYR_DEFAULT_MULTIPLEX true
+#define GLYR_DEFAULT_MAX_HOST_CONNECTIONS 0
+#define GLYR_DEFAULT_MAX_HOST_STREAMS 100
+#define GLYR_DEFAULT_HEDGE 0.0
+#define GLYR_DEFAULT_DEADLINE 0
+#define GLYR_DEFAULT_MAX_BYTES -1
+#define GLYR_DEFAULT_MAX_IMAGE_BYTES (16 * 1024 * 1024)
+#define GLYR_DEFAULT_TRACE false
+#define GLYR_DEFAULT_BATCH_PARALLEL 8
+#define GLYR_DEFAULT_ASYNC_WORKERS 8
+#define GLYR_DEFAULT_RESPONSE_CACHE_SIZE 0
+#define GLYR_DEFAULT_RESPONSE_CACHE_AGE 300
 
     /* Disallow *.gif, mostly bad quality
      * jpeg and jpg, because some not standardaware
@@ -107,6 +122,33 @@ extern "C"
     }
                                  GLYR_NORMALIZATION;
 
+    /**
+     * GLYR_SHARE_FLAGS:
+     * @GLYR_SHARE_NONE: Every download resolves and connects on its own.
+     * @GLYR_SHARE_DNS: Share the DNS cache between all downloads.
+     * @GLYR_SHARE_SSL_SESSION: Share TLS session ids, so resumed handshakes are cheaper.
+     * @GLYR_SHARE_CONNECTIONS: Share curl's connection cache between all easy handles; experimental, see below.
+     * @GLYR_SHARE_ALL: GLYR_SHARE_DNS and GLYR_SHARE_SSL_SESSION.
+     *
+     * What the library wide connection pool shares between queries and threads.
+     * See glyr_pool_configure().
+     *
+     * Open connections are reused anyway: they stay with the pooled multi handles,
+     * which are handed to the next query. Sharing curl's connection cache on top of that
+     * is not reliable across threads, so GLYR_SHARE_CONNECTIONS is not part of GLYR_SHARE_ALL.
+     *
+     * Default is: GLYR_SHARE_ALL
+     **/
+    typedef enum
+    {
+        GLYR_SHARE_NONE        = 0,
+        GLYR_SHARE_DNS         = 1 << 0,
+        GLYR_SHARE_SSL_SESSION = 1 << 1,
+        GLYR_SHARE_CONNECTIONS = 1 << 2,
+        GLYR_SHARE_ALL         = GLYR_SHARE_DNS | GLYR_SHARE_SSL_SESSION
+    }
+                                 GLYR_SHARE_FLAGS;
+
     /**
      * GLYR_ERROR:
      * @GLYRE_UNKNOWN: Unknown error
@@ -295,9 +337,11 @@ extern "C"
      * @timestamp: This is used internally by libglyr.
      * @next: A pointer to the next item in the list, or NULL
      * @prev: A pointer to the previous item in the list, or NULL
+     * @path: The file @data is mapped from, if downloaded with glyr_opt_download_dir(); NULL otherwise.
      *
      * GlyrMemCache represents a single item received by libglyr.
      * You should <emphasis>NOT</emphasis> modify any of the fields directly, they are meant to be read-only.
+     * This is true for @data in particular: copies made by glyr_cache_copy() share the same buffer.
      * If you need to set any field (usually only necessary in conjunction with glyr/cache.h) you may
      * want to use the glyr_cache_set_[public field] routines to safely modify the data.
      */
@@ -320,6 +364,13 @@ extern "C"
 
         struct _GlyrMemCache * next;
         struct _GlyrMemCache * prev;
+
+        char * path;
+
+        /*< private >*/
+        const char * md5_data; /* Do not use! - @data and @size when @md5sum was calculated */
+        size_t md5_size;
+        void * shared; /* Do not use! - refcounted block behind @data, shared by copies */
     } GlyrMemCache;
 
     /**
@@ -340,6 +391,45 @@ extern "C"
 
     } GlyrDatabase;
 
+    /**
+     * GlyrTransferTrace:
+     * @url: The URL that was requested.
+     * @provider: The provider this transfer was made for, NULL if unknown (e.g. for glyr_download()).
+     * @result: The libcurl result code, 0 on success.
+     * @cached: The response came from the response cache, there was no transfer.
+     * @namelookup: Milliseconds until the hostname was resolved.
+     * @connect: Milliseconds until the connection was established.
+     * @appconnect: Milliseconds until the TLS handshake was done, 0 without TLS.
+     * @starttransfer: Milliseconds until the first byte of the response came in.
+     * @total: Milliseconds the whole transfer took.
+     * @bytes: Number of bytes received.
+     * @parse_time: CPU milliseconds the provider spent parsing the response.
+     * @next: The transfer done before this one.
+     *
+     * Timing of a single transfer, see glyr_opt_trace().
+     * Like in libcurl all times count from the start of the transfer, so e.g.
+     * @connect - @namelookup is the TCP handshake and @starttransfer - @appconnect
+     * is the time the server needed to answer. Reused connections show 0 for the first steps.
+     */
+    typedef struct _GlyrTransferTrace
+    {
+        /*< public >*/
+        char * url;
+        char * provider;
+        int result;
+        bool cached;
+
+        double namelookup;
+        double connect;
+        double appconnect;
+        double starttransfer;
+        double total;
+        size_t bytes;
+        double parse_time;
+
+        struct _GlyrTransferTrace * next;
+    } GlyrTransferTrace;
+
     /**
     * GlyrQuery:
     * @type: The type of metadata to get.
@@ -352,12 +442,20 @@ extern "C"
     * @parallel: Max. number of parallel queried providers.
     * @timeout: Max. timeout in seconds to wait before cancelling a download.
     * @redirects: Max number of redirects. You shouldn't set this.
+    * @multiplex: Run parallel requests to one host over one HTTP/2 connection, if possible.
+    * @max_host_connections: Max. number of connections per host; 0 -> unlimited
+    * @max_host_streams: Max. number of multiplexed requests per connection.
+    * @hedge: Latency percentile after which the next provider is started speculatively; 0 -> off
+    * @deadline: Max. time in milliseconds a glyr_get() may take in total; 0 -> no limit
+    * @max_bytes: Max. size of a single download in bytes; 0 -> no limit, -1 -> GLYR_DEFAULT_MAX_IMAGE_BYTES for images
+    * @trace: Record a GlyrTransferTrace for each transfer, see glyr_query_get_trace()
     * @force_utf8: Should be UTF8 forced on text items?
     * @download: should be images downloaded?
     * @qsratio: 0.0 = maxspeed, 1.0 = max quality, 0.85 -> default.
     * @db_autoread: Check if the found item is already cached.
     * @db_autowrite: Write found items automagically to the cache, if any specified by glyr_opt_lookup_db()
     * @local_db: The database to write and search in.
+    * @db_negative_ttl: Seconds a provider that found nothing is not asked again for the same query; 0 -> always ask
     * @lang_aware_only: Use only providers that deliver language specific content.
     * @signal_exit: By default false, but true when stopping searching is required.
     * @lang: Language code ISO-639-1, like 'de','en' or 'auto'
@@ -369,6 +467,7 @@ extern "C"
     * @allowed_formats: Allowed imageformats.
     * @useragent: Useragent to use during http-requests
     * @musictree_path: Used for the musictree provider.
+    * @download_dir: Directory downloaded images are streamed to; NULL keeps them in memory.
     * @q_errno: Any error that happenend during glyr_get() (same as argument to glyr_get())
     * @normalization: What normalization to apply to artist/album/title; GLYR_NORMALIZE_MODERATE is default.
     *
@@ -394,6 +493,14 @@ extern "C"
         int timeout;
         int redirects;
 
+        bool multiplex;
+        int max_host_connections;
+        int max_host_streams;
+        float hedge;
+        int deadline;
+        long max_bytes;
+        bool trace;
+
         bool force_utf8;
         bool download;
         float qsratio;
@@ -405,6 +512,7 @@ extern "C"
         bool db_autoread;
         bool db_autowrite;
         GlyrDatabase * local_db;
+        int db_negative_ttl;
 
         bool lang_aware_only;
 
@@ -421,6 +529,7 @@ extern "C"
         char * allowed_formats;
         char * useragent;
         char * musictree_path;
+        char * download_dir;
 
 #ifndef __GTK_DOC_IGNORE__
         struct
@@ -435,6 +544,9 @@ extern "C"
         char * info[10]; /*!< Do not use! - A register where porinters to all dynamic alloc. fields are saved. Do not use. */
         bool imagejob; /*! Do not use! - Wether this query will get images or urls to them */
         long is_initalized; /* Do not use! - Wether this query was initialized correctly */
+        long long deadline_at; /* Do not use! - Monotonic time (usec) when @deadline runs out, 0 if none */
+        GlyrTransferTrace * trace_head; /* Do not use! - Transfers of the last glyr_get(), see glyr_query_get_trace() */
+        void * accepted; /* Do not use! - md5sums of the items found so far, only while searching */
 
     } GlyrQuery;
 
@@ -446,6 +558,8 @@ extern "C"
      * @quality: A quality rating from 0-100
      * @speed: A speed rating form 0
      * @lang_aware: Does this provider offer language specific content?
+     * @failures: Connect or timeout failures in a row, as seen by this process.
+     * @retry_in: Seconds until the provider is asked again after it failed too often; 0 if it is usable.
      * @next: A pointer to the next provider.
      * @prev: A pointer to the previous provider.
      *
@@ -466,6 +580,8 @@ extern "C"
         int quality;
         int speed;
         bool lang_aware;
+        int failures;
+        int retry_in;
 
         struct _GlyrSourceInfo * next;
         struct _GlyrSourceInfo * prev;
@@ -502,6 +618,48 @@ extern "C"
         struct _GlyrFetcherInfo * prev;
     } GlyrFetcherInfo;
 
+    /**
+     * GlyrBatchStats:
+     * @queries: Number of queries that were run.
+     * @found: Queries that delivered at least one item.
+     * @failed: Queries that ended with an error other than GLYRE_OK.
+     * @items: Items delivered over all queries.
+     * @seconds: Wall-clock time the whole batch took.
+     * @queries_per_second: Throughput of the batch.
+     *
+     * Filled by glyr_get_batch() once all queries are done.
+     */
+    typedef struct _GlyrBatchStats
+    {
+        /*< public >*/
+        int queries;
+        int found;
+        int failed;
+        int items;
+        double seconds;
+        double queries_per_second;
+    } GlyrBatchStats;
+
+    /**
+     * GlyrResponseCacheStats:
+     * @hits: Responses served from memory, without any network I/O.
+     * @revalidated: Stale responses the server confirmed as unchanged (304 Not Modified).
+     * @misses: Responses that had to be downloaded.
+     * @entries: Responses stored right now.
+     * @bytes: Memory used by the stored responses.
+     *
+     * Filled by glyr_response_cache_stats().
+     */
+    typedef struct _GlyrResponseCacheStats
+    {
+        /*< public >*/
+        unsigned long hits;
+        unsigned long revalidated;
+        unsigned long misses;
+        size_t entries;
+        size_t bytes;
+    } GlyrResponseCacheStats;
+
 
     /**
      * DL_callback:
@@ -514,6 +672,29 @@ extern "C"
     */
     typedef GLYR_ERROR (*DL_callback) (GlyrMemCache * dl, struct _GlyrQuery * s);
 
+    /**
+     * GlyrAsyncItemCB:
+     * @query: The GlyrQuery passed to glyr_get_async()
+     * @item: A copy of the item that was just found. It is freed after the callback returns,
+     *        use glyr_cache_copy() to keep it.
+     * @userdata: The userdata passed to glyr_get_async()
+     *
+     * Called from glyr_dispatch() for every item of a query started with glyr_get_async().
+     */
+    typedef void (*GlyrAsyncItemCB) (struct _GlyrQuery * query, GlyrMemCache * item, void * userdata);
+
+    /**
+     * GlyrAsyncDoneCB:
+     * @query: The GlyrQuery passed to glyr_get_async(); you may modify or destroy it again.
+     * @list: What glyr_get() would have returned; free it with glyr_free_list()
+     * @error: What glyr_get() would have set as error.
+     * @length: The length of @list
+     * @userdata: The userdata passed to glyr_get_async()
+     *
+     * Called from glyr_dispatch() once a query started with glyr_get_async() is finished.
+     */
+    typedef void (*GlyrAsyncDoneCB) (struct _GlyrQuery * query, GlyrMemCache * list, GLYR_ERROR error, int length, void * userdata);
+
 #ifdef __cplusplus
 }
 #endif
@@ -112,6 +112,31 @@ END_TEST
 
 //--------------------
 
+START_TEST (test_glyr_cache_copy_shared)
+{
+    GlyrMemCache * test = glyr_cache_new();
+    glyr_cache_set_data (test,g_strdup ("some data"),-1);
+
+    /* A copy of a copy shares the buffer */
+    GlyrMemCache * copy = glyr_cache_copy (test);
+    GlyrMemCache * other = glyr_cache_copy (copy);
+    fail_unless (other->data == copy->data,"Copies should share their data");
+    fail_unless (other->size == copy->size,NULL);
+
+    /* Setting new data must not touch the other copies */
+    glyr_cache_set_data (copy,g_strdup ("other data"),-1);
+    fail_unless (g_strcmp0 (other->data,"some data") == 0,NULL);
+    fail_unless (g_strcmp0 (copy->data,"other data") == 0,NULL);
+
+    glyr_cache_free (test);
+    glyr_cache_free (copy);
+    fail_unless (g_strcmp0 (other->data,"some data") == 0,NULL);
+    glyr_cache_free (other);
+}
+END_TEST
+
+//--------------------
+
 START_TEST (test_glyr_query_destroy)
 {
     GlyrQuery q;
@@ -197,6 +222,244 @@ END_TEST
 
 //--------------------
 
+static void async_done (GlyrQuery * q, GlyrMemCache * list, GLYR_ERROR error, int length, void * userdata)
+{
+    * (int *) userdata = length + 1;
+    glyr_free_list (list);
+}
+
+START_TEST (test_glyr_get_async)
+{
+    GlyrQuery q;
+    glyr_init();
+    atexit (glyr_cleanup);
+
+    fail_unless (glyr_get_async (NULL,NULL,NULL,NULL) == GLYRE_NO_INIT,"should not access bad memory");
+
+    setup (&q,GLYR_GET_COVERART,1);
+    fail_unless (glyr_get_async_fd() != -1,NULL);
+
+    int done = 0;
+    fail_unless (glyr_get_async (&q,NULL,async_done,&done) == GLYRE_OK,NULL);
+    while (done == 0)
+    {
+        g_usleep (10000);
+        glyr_dispatch();
+    }
+    fail_unless (done == 2,"should have found exactly one item");
+    glyr_query_destroy (&q);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_get_batch)
+{
+    glyr_init();
+    atexit (glyr_cleanup);
+
+    GlyrQuery one, two;
+    GlyrQuery * batch[] = {&one, &two};
+    setup (&one,GLYR_GET_COVERART,1);
+    setup (&two,GLYR_GET_ARTIST_PHOTOS,2);
+    glyr_opt_download (&two,false);
+
+    GlyrBatchStats stats;
+    fail_unless (glyr_get_batch (batch,2,0,&stats) == GLYRE_OK,NULL);
+    fail_unless (stats.queries == 2,NULL);
+    fail_unless (stats.found == 2,NULL);
+    fail_unless (stats.items == 3,NULL);
+
+    glyr_query_destroy (&one);
+    glyr_query_destroy (&two);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_response_cache)
+{
+    glyr_init();
+    atexit (glyr_cleanup);
+    glyr_response_cache_configure (1024 * 1024,60);
+
+    GlyrMemCache * a = glyr_download ("www.duckduckgo.com",NULL);
+    GlyrMemCache * b = glyr_download ("www.duckduckgo.com",NULL);
+    fail_unless (a != NULL && b != NULL,NULL);
+    fail_unless (a->size == b->size,NULL);
+
+    GlyrResponseCacheStats stats;
+    glyr_response_cache_stats (&stats);
+    fail_unless (stats.hits == 1,NULL);
+    fail_unless (stats.entries == 1,NULL);
+
+    glyr_cache_free (a);
+    glyr_cache_free (b);
+}
+END_TEST
+
+//--------------------
+
+/* Static file, the server sends an ETag and a Last-Modified for it */
+#define STATIC_URL "http://www.gnu.org/licenses/lgpl-3.0.txt"
+
+START_TEST (test_glyr_response_cache_revalidate)
+{
+    glyr_init();
+    atexit (glyr_cleanup);
+
+    /* Everything is stale at once, so the second download asks the server */
+    glyr_response_cache_configure (1024 * 1024,0);
+
+    GlyrMemCache * a = glyr_download (STATIC_URL,NULL);
+    GlyrMemCache * b = glyr_download (STATIC_URL,NULL);
+    fail_unless (a != NULL && b != NULL,NULL);
+    fail_unless (a->size == b->size,NULL);
+    fail_unless (memcmp (a->md5sum,b->md5sum,16) == 0,NULL);
+
+    /* 304 Not Modified, the body came from memory */
+    GlyrResponseCacheStats stats;
+    glyr_response_cache_stats (&stats);
+    fail_unless (stats.misses == 1,NULL);
+    fail_unless (stats.revalidated == 1,NULL);
+    fail_unless (stats.hits == 0,NULL);
+    fail_unless (stats.entries == 1,NULL);
+
+    glyr_cache_free (a);
+    glyr_cache_free (b);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_response_cache_evict)
+{
+    glyr_init();
+    atexit (glyr_cleanup);
+    glyr_response_cache_configure (1024 * 1024,60);
+
+    GlyrMemCache * list[] =
+    {
+        glyr_download (STATIC_URL,NULL),
+        glyr_download ("www.duckduckgo.com",NULL),
+        glyr_download (STATIC_URL,NULL) /* Hit, most recently used now */
+    };
+    for (gsize i = 0; i < G_N_ELEMENTS (list); i++)
+    {
+        fail_unless (list[i] != NULL,NULL);
+        glyr_cache_free (list[i]);
+    }
+
+    GlyrResponseCacheStats stats;
+    glyr_response_cache_stats (&stats);
+    fail_unless (stats.hits == 1,NULL);
+    fail_unless (stats.entries == 2,NULL);
+
+    /* One byte short: the least recently used one has to go */
+    glyr_response_cache_configure (stats.bytes - 1,60);
+    glyr_response_cache_stats (&stats);
+    fail_unless (stats.entries == 1,NULL);
+
+    GlyrMemCache * kept = glyr_download (STATIC_URL,NULL);
+    fail_unless (kept != NULL,NULL);
+    glyr_response_cache_stats (&stats);
+    fail_unless (stats.hits == 2,NULL);
+    fail_unless (stats.misses == 2,NULL);
+
+    GlyrMemCache * gone = glyr_download ("www.duckduckgo.com",NULL);
+    fail_unless (gone != NULL,NULL);
+    glyr_response_cache_stats (&stats);
+    fail_unless (stats.misses == 3,NULL);
+
+    glyr_cache_free (kept);
+    glyr_cache_free (gone);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_host_limit)
+{
+    glyr_init();
+    atexit (glyr_cleanup);
+    glyr_host_limit_configure ("WWW.duckduckgo.com",1.0,1);
+
+    /* One token to start with, the other two have to wait for theirs */
+    GTimer * timer = g_timer_new();
+    for (int i = 0; i < 3; i++)
+    {
+        GlyrMemCache * c = glyr_download ("www.duckduckgo.com",NULL);
+        fail_unless (c != NULL,NULL);
+        glyr_cache_free (c);
+    }
+    fail_unless (g_timer_elapsed (timer,NULL) >= 1.9,NULL);
+
+    g_timer_destroy (timer);
+}
+END_TEST
+
+//--------------------
+
+static gpointer stop_soon (gpointer query)
+{
+    g_usleep (200 * 1000);
+    glyr_signal_exit (query);
+    return NULL;
+}
+
+START_TEST (test_glyr_signal_exit)
+{
+    glyr_init();
+    atexit (glyr_cleanup);
+
+    GlyrQuery q;
+    setup (&q,GLYR_GET_COVERART,10);
+    glyr_opt_timeout (&q,20);
+
+    GThread * stopper = g_thread_new ("stopper",stop_soon,&q);
+    GTimer * timer = g_timer_new();
+    GlyrMemCache * list = glyr_get (&q,NULL,NULL);
+    fail_unless (g_timer_elapsed (timer,NULL) < 1.0,NULL);
+    fail_unless (list == NULL,NULL);
+
+    g_thread_join (stopper);
+    g_timer_destroy (timer);
+    glyr_free_list (list);
+    glyr_query_destroy (&q);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_query_get_trace)
+{
+    glyr_init();
+    atexit (glyr_cleanup);
+
+    GlyrQuery q;
+    setup (&q,GLYR_GET_LYRICS,1);
+    fail_unless (glyr_query_get_trace (&q) == NULL,NULL);
+    glyr_opt_trace (&q,true);
+
+    GlyrMemCache * list = glyr_get (&q,NULL,NULL);
+    fail_unless (list != NULL,NULL);
+
+    GlyrTransferTrace * trace = glyr_query_get_trace (&q);
+    fail_unless (trace != NULL,NULL);
+    for (; trace; trace = trace->next)
+    {
+        fail_unless (trace->url != NULL,NULL);
+        fail_unless (trace->total >= trace->namelookup,NULL);
+        fail_unless (trace->parse_time >= 0,NULL);
+    }
+
+    glyr_free_list (list);
+    glyr_query_destroy (&q);
+}
+END_TEST
+
+//--------------------
+
 Suite * create_test_suite (void)
 {
     Suite *s = suite_create ("Libglyr API");
@@ -210,9 +473,18 @@ Suite * create_test_suite (void)
     tcase_add_test (tc_core, test_glyr_free_list);
     tcase_add_test (tc_core, test_glyr_cache_free);
     tcase_add_test (tc_core, test_glyr_cache_copy);
+    tcase_add_test (tc_core, test_glyr_cache_copy_shared);
     tcase_add_test (tc_core, test_glyr_cache_set_data);
     tcase_add_test (tc_core, test_glyr_cache_write);
     tcase_add_test (tc_core, test_glyr_download);
+    tcase_add_test (tc_core, test_glyr_get_async);
+    tcase_add_test (tc_core, test_glyr_get_batch);
+    tcase_add_test (tc_core, test_glyr_response_cache);
+    tcase_add_test (tc_core, test_glyr_response_cache_revalidate);
+    tcase_add_test (tc_core, test_glyr_response_cache_evict);
+    tcase_add_test (tc_core, test_glyr_host_limit);
+    tcase_add_test (tc_core, test_glyr_signal_exit);
+    tcase_add_test (tc_core, test_glyr_query_get_trace);
     suite_add_tcase (s, tc_core);
     return s;
 }
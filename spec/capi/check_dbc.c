@@ -349,6 +349,111 @@ START_TEST (test_db_editplace)
 }
 END_TEST
 
+//--------------------
+
+static int count_misses (GlyrDatabase * db)
+{
+    int rows = -1;
+    sqlite3_stmt * stmt = NULL;
+    if (sqlite3_prepare_v2 (db->db_handle,"SELECT count(*) FROM negative_results WHERE fingerprint IS NOT NULL;",-1,&stmt,NULL) == SQLITE_OK)
+    {
+        if (sqlite3_step (stmt) == SQLITE_ROW)
+        {
+            rows = sqlite3_column_int (stmt,0);
+        }
+    }
+    sqlite3_finalize (stmt);
+    return rows;
+}
+
+//--------------------
+
+static int count_transfers (GlyrQuery * q)
+{
+    int transfers = 0;
+    for (GlyrTransferTrace * trace = glyr_query_get_trace (q); trace; trace = trace->next)
+    {
+        transfers++;
+    }
+    return transfers;
+}
+
+//--------------------
+
+static GLYR_ERROR ignore_callback (GlyrMemCache * c, GlyrQuery * q)
+{
+    return GLYRE_OK;
+}
+
+//--------------------
+
+/* Runs q twice; the second run has to skip the providers that missed in the first.
+ * Returns the number of transfers of the second run.
+ */
+static int check_skips_misses (GlyrDatabase * db, GlyrQuery * q)
+{
+    int misses_before = count_misses (db);
+
+    GLYR_ERROR err = GLYRE_OK;
+    int length = 0;
+    GlyrMemCache * list = glyr_get (q,&err,&length);
+    fail_unless (length == 0,NULL);
+    glyr_free_list (list);
+
+    int first_transfers = count_transfers (q);
+    fail_unless (count_misses (db) > misses_before,"misses were not recorded");
+
+    list = glyr_get (q,&err,&length);
+    fail_unless (length == 0,NULL);
+    fail_unless (err == GLYRE_OK,NULL);
+    glyr_free_list (list);
+
+    int second_transfers = count_transfers (q);
+    fail_unless (second_transfers < first_transfers,"known misses were asked again");
+    return second_transfers;
+}
+
+//--------------------
+
+START_TEST (test_negative_results)
+{
+    GlyrDatabase * db = setup_db();
+    GlyrQuery q;
+    setup (&q,GLYR_GET_LYRICS,1);
+    glyr_opt_artist (&q,"Nobody ever called a band like this");
+    glyr_opt_title (&q,"Nor a song like this");
+    glyr_opt_lookup_db (&q,db);
+    glyr_opt_trace (&q,true);
+
+    fail_unless (glyr_opt_db_negative_ttl (&q,-1) == GLYRE_BAD_VALUE,NULL);
+    fail_unless (glyr_opt_db_negative_ttl (&q,60) == GLYRE_OK,NULL);
+
+    /* The first run asks everyone, the second one knows better */
+    int known_transfers = check_skips_misses (db,&q);
+
+    /* Neither the ttl nor the number of items makes it another query */
+    glyr_opt_db_negative_ttl (&q,120);
+    glyr_opt_number (&q,2);
+    GLYR_ERROR err = GLYRE_OK;
+    GlyrMemCache * list = glyr_get (&q,&err,NULL);
+    glyr_free_list (list);
+    fail_unless (count_transfers (&q) <= known_transfers,"misses were forgotten");
+    glyr_query_destroy (&q);
+
+    /* Same with a download callback, like glyrc and glyr_get_async() use */
+    setup (&q,GLYR_GET_LYRICS,1);
+    glyr_opt_artist (&q,"Nobody ever called another band like this");
+    glyr_opt_title (&q,"Nor another song like this");
+    glyr_opt_lookup_db (&q,db);
+    glyr_opt_trace (&q,true);
+    glyr_opt_db_negative_ttl (&q,60);
+    glyr_opt_dlcallback (&q,ignore_callback,NULL);
+    check_skips_misses (db,&q);
+
+    glyr_query_destroy (&q);
+    glyr_db_destroy (db);
+}
+END_TEST
 
 //--------------------
 
@@ -365,6 +470,7 @@ Suite * create_test_suite (void)
     tcase_add_test (tc_dbcache, test_sorted_rating);
     tcase_add_test (tc_dbcache, test_intelligent_lookup);
     tcase_add_test (tc_dbcache, test_db_editplace);
+    tcase_add_test (tc_dbcache, test_negative_results);
     suite_add_tcase (s, tc_dbcache);
     return s;
 }
@@ -174,6 +174,137 @@ END_TEST
 
 //--------------------
 
+START_TEST (test_glyr_opt_multiplex)
+{
+    GlyrQuery q;
+    int length = 0;
+    setup (&q,GLYR_GET_ARTIST_PHOTOS,2);
+
+    fail_unless (glyr_opt_max_host_connections (&q,-1) == GLYRE_BAD_VALUE,NULL);
+    fail_unless (glyr_opt_max_host_streams (&q,0) == GLYRE_BAD_VALUE,NULL);
+
+    /* Everything over one connection per host */
+    glyr_opt_multiplex (&q,true);
+    glyr_opt_max_host_connections (&q,1);
+    GlyrMemCache * list = glyr_get (&q,NULL,&length);
+    fail_unless (length == 2,NULL);
+    glyr_free_list (list);
+
+    glyr_opt_multiplex (&q,false);
+    list = glyr_get (&q,NULL,&length);
+    fail_unless (length == 2,NULL);
+
+    unsetup (&q,list);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_opt_hedge)
+{
+    GlyrQuery q;
+    int length = 0;
+    setup (&q,GLYR_GET_COVERART,1);
+
+    fail_unless (glyr_opt_hedge (&q,-0.5) == GLYRE_BAD_VALUE,NULL);
+    fail_unless (glyr_opt_hedge (&q,1.5) == GLYRE_BAD_VALUE,NULL);
+    fail_unless (glyr_opt_hedge (&q,0.95) == GLYRE_OK,NULL);
+
+    /* One at a time, the hedged ones have to step in */
+    glyr_opt_parallel (&q,1);
+    GlyrMemCache * list = glyr_get (&q,NULL,&length);
+    fail_unless (length == 1,NULL);
+
+    unsetup (&q,list);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_opt_deadline)
+{
+    GlyrQuery q;
+    int length = 0;
+    setup (&q,GLYR_GET_COVERART,5);
+
+    fail_unless (glyr_opt_deadline (&q,-1) == GLYRE_BAD_VALUE,NULL);
+    fail_unless (glyr_opt_deadline (&q,1500) == GLYRE_OK,NULL);
+
+    /* Way longer than allowed, were it not for the deadline */
+    glyr_opt_timeout (&q,20);
+    GTimer * timer = g_timer_new();
+    GlyrMemCache * list = glyr_get (&q,NULL,&length);
+    fail_unless (g_timer_elapsed (timer,NULL) < 2.5,NULL);
+    g_timer_destroy (timer);
+
+    unsetup (&q,list);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_opt_download_dir)
+{
+    GlyrQuery q;
+    int length = 0;
+    setup (&q,GLYR_GET_COVERART,2);
+
+    gchar * dir = g_dir_make_tmp ("glyr-check-XXXXXX",NULL);
+    fail_unless (dir != NULL,NULL);
+
+    fail_unless (glyr_opt_download_dir (NULL,dir) == GLYRE_EMPTY_STRUCT,NULL);
+    fail_unless (glyr_opt_download_dir (&q,"/no/such/directory") == GLYRE_BAD_VALUE,NULL);
+    fail_unless (glyr_opt_download_dir (&q,dir) == GLYRE_OK,NULL);
+
+    GlyrMemCache * list = glyr_get (&q,NULL,&length);
+    for (GlyrMemCache * elem = list; elem; elem = elem->next)
+    {
+        /* Mapped from a file in dir, with the same content */
+        fail_unless (elem->path != NULL,NULL);
+        fail_unless (g_str_has_prefix (elem->path,dir),NULL);
+
+        gchar * content = NULL;
+        gsize size = 0;
+        fail_unless (g_file_get_contents (elem->path,&content,&size,NULL),NULL);
+        fail_unless (size == elem->size && memcmp (content,elem->data,size) == 0,NULL);
+        g_free (content);
+    }
+
+    /* The images stay once freed */
+    gchar * first_path = (list) ? g_strdup (list->path) : NULL;
+    unsetup (&q,list);
+    fail_unless (first_path == NULL || g_file_test (first_path,G_FILE_TEST_EXISTS),NULL);
+
+    g_free (first_path);
+    g_free (dir);
+}
+END_TEST
+
+//--------------------
+
+START_TEST (test_glyr_opt_max_bytes)
+{
+    GlyrQuery q;
+    int length = 0;
+    setup (&q,GLYR_GET_COVERART,1);
+
+    fail_unless (glyr_opt_max_bytes (NULL,1) == GLYRE_EMPTY_STRUCT,NULL);
+    fail_unless (glyr_opt_max_bytes (&q,-2) == GLYRE_BAD_VALUE,NULL);
+    fail_unless (glyr_opt_max_bytes (&q,-1) == GLYRE_OK,NULL);
+
+    /* No cover is that small */
+    fail_unless (glyr_opt_max_bytes (&q,64) == GLYRE_OK,NULL);
+    glyr_opt_download (&q,true);
+    GlyrMemCache * list = glyr_get (&q,NULL,&length);
+    fail_unless (list == NULL,NULL);
+    fail_unless (length == 0,NULL);
+
+    unsetup (&q,list);
+}
+END_TEST
+
+//--------------------
+
 Suite * create_test_suite (void)
 {
     Suite *s = suite_create ("Libglyr");
@@ -186,6 +317,11 @@ Suite * create_test_suite (void)
     tcase_add_test (tc_options, test_glyr_opt_number);
     tcase_add_test (tc_options, test_glyr_opt_allowed_formats);
     tcase_add_test (tc_options, test_glyr_opt_proxy);
+    tcase_add_test (tc_options, test_glyr_opt_multiplex);
+    tcase_add_test (tc_options, test_glyr_opt_hedge);
+    tcase_add_test (tc_options, test_glyr_opt_deadline);
+    tcase_add_test (tc_options, test_glyr_opt_download_dir);
+    tcase_add_test (tc_options, test_glyr_opt_max_bytes);
     suite_add_tcase (s, tc_options);
     return s;
 }
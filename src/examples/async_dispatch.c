@@ -0,0 +1,91 @@
+/***********************************************************
+ * This file is part of glyr
+ * + a command-line tool and library to download various sort of music related metadata.
+ * + Copyright (C) [2011-2016]  [Christopher Pahl]
+ * + Hosted at: https://github.com/sahib/glyr
+ *
+ * glyr is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glyr is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with glyr. If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************/
+
+#include "../../lib/glyr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <poll.h>
+
+/*
+ * Runs a few queries at once without any thread of our own,
+ * using glyr_get_async() and a plain poll() loop.
+ *
+ * Compile with:
+ * gcc async_dispatch.c -o async_dispatch -lglyr -std=c99 -Wall
+ */
+
+/////////////////////////////////
+
+static int running = 0;
+
+/////////////////////////////////
+
+static void on_item (GlyrQuery * q, GlyrMemCache * item, void * userdata)
+{
+    printf ("[%s] found an item from %s\n", (const char *) userdata, item->prov);
+}
+
+/////////////////////////////////
+
+static void on_done (GlyrQuery * q, GlyrMemCache * list, GLYR_ERROR error, int length, void * userdata)
+{
+    printf ("[%s] done with %d item(s): %s\n", (const char *) userdata, length, glyr_strerror (error) );
+    glyr_free_list (list);
+    glyr_query_destroy (q);
+    running--;
+}
+
+/////////////////////////////////
+
+int main (void)
+{
+    glyr_init();
+    atexit (glyr_cleanup);
+
+    static const char * artists[] = {"Equilibrium", "Knorkator", "Farin Urlaub"};
+    GlyrQuery queries[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        glyr_query_init (&queries[i]);
+        glyr_opt_type (&queries[i], GLYR_GET_ARTIST_PHOTOS);
+        glyr_opt_artist (&queries[i], artists[i]);
+        glyr_opt_download (&queries[i], false);
+        glyr_opt_number (&queries[i], 2);
+
+        if (glyr_get_async (&queries[i], on_item, on_done, (void *) artists[i]) == GLYRE_OK)
+        {
+            running++;
+        }
+    }
+
+    struct pollfd pfd = {.fd = glyr_get_async_fd(), .events = POLLIN};
+    while (running > 0)
+    {
+        /* Your main loop would do other things meanwhile */
+        if (poll (&pfd, 1, 1000) > 0)
+        {
+            glyr_dispatch();
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
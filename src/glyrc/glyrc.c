@@ -285,9 +285,14 @@ void help_short (GlyrQuery * s)
             IN"-r --redirects           Integer. Define the number of redirects that are allowed.\n"
             IN"-m --timeout             Integer. Define the maximum number in seconds after which a download is cancelled.\n"
             IN"-k --proxy               String: Set the proxy to use in the form of [protocol://][user:pass@]yourproxy.domain[:port]\n"
+            IN"-M --no-multiplex        Don't multiplex parallel requests to one host over a single HTTP/2 connection.\n"
+            IN"-H --hedge               Float: Start the next provider if nothing came in after this latency percentile (e.g. 0.95)\n"
+            IN"-B --deadline            Integer: Return what was found after this many milliseconds, regardless of --timeout.\n"
             "\nPROVIDER SPECIFIC OPTIONS\n"
             IN"-d --download            Download Images.\n"
             IN"-D --no-download         Don't download images, but return the URLs to them (act like a search engine)\n"
+            IN"-O --download-dir        String: Stream downloaded images into this directory instead of keeping them in memory\n"
+            IN"-X --max-bytes           Integer: Drop downloads larger than this many bytes; 0 for no limit, -1 limits images to 16 MiB (default)\n"
             IN"-a --artist              String: Artist name to search for\n"
             IN"-b --album               String: Album name to search for\n"
             IN"-t --title               String: Songname to search for\n"
@@ -310,6 +315,7 @@ void help_short (GlyrQuery * s)
             IN"                                    * path : The path were the item was written to.\n"
             "\nDATABASE OPTIONS\n"
             IN"-c --cache <folder>      Creates or opens an existing cache at <folder>/metadata.db and lookups data from there.\n"
+            IN"-T --negative-ttl        Integer: Seconds to skip providers that found nothing for the same query; 0 asks them anyway.\n"
             IN"cache select [Query]     Selects data from the cache; you can use any other option behind this.\n"
             IN"cache delete [Query]     Instead of searching for this element, the element is deleted from the database. Needs --cache.\n"
             IN"cache list               List all items in the database (including the artist / album / title / type) - Needs --cache.\n"
@@ -399,10 +405,16 @@ static void parse_commandline_general (int argc, char * const * argv, GlyrQuery
         {"qsratio",       required_argument, 0, 'q'},
         {"formats",       required_argument, 0, 'F'},
         {"cache",         optional_argument, 0, 'c'},
+        {"negative-ttl",  required_argument, 0, 'T'},
         {"help",          no_argument,       0, 'h'},
         {"version",       no_argument,       0, 'V'},
         {"download",      no_argument,       0, 'd'},
         {"no-download",   no_argument,       0, 'D'},
+        {"download-dir",  required_argument, 0, 'O'},
+        {"max-bytes",     required_argument, 0, 'X'},
+        {"no-multiplex",  no_argument,       0, 'M'},
+        {"hedge",         required_argument, 0, 'H'},
+        {"deadline",      required_argument, 0, 'B'},
         {"list",          no_argument,       0, 'L'},
         {"force-utf8",    no_argument,       0, '8'},
         {"as-one",        no_argument,       0, 'g'},
@@ -429,7 +441,7 @@ static void parse_commandline_general (int argc, char * const * argv, GlyrQuery
     {
         gint c;
         gint option_index = 0;
-        if ( (c = getopt_long (argc, argv, "N:f:W:w:p:r:m:x:u:v:q:c::F:hVodDLa:b:t:i:e:s:n:l:z:j:k:8gGyY",long_options, &option_index) ) == -1)
+        if ( (c = getopt_long (argc, argv, "N:f:W:w:p:r:m:x:u:v:q:c::T:F:H:B:O:X:hVodDMLa:b:t:i:e:s:n:l:z:j:k:8gGyY",long_options, &option_index) ) == -1)
         {
             break;
         }
@@ -554,6 +566,28 @@ static void parse_commandline_general (int argc, char * const * argv, GlyrQuery
         case '8':
             glyr_opt_force_utf8 (glyrs,true);
             break;
+        case 'M':
+            glyr_opt_multiplex (glyrs,false);
+            break;
+        case 'H':
+            glyr_opt_hedge (glyrs,atof (optarg) );
+            break;
+        case 'B':
+            glyr_opt_deadline (glyrs,atoi (optarg) );
+            break;
+        case 'O':
+            if (glyr_opt_download_dir (glyrs,optarg) != GLYRE_OK)
+            {
+                cprint (RED,-1,NULL,"Error: '%s' is not a directory.\n",optarg);
+                exit (-1);
+            }
+            break;
+        case 'X':
+            glyr_opt_max_bytes (glyrs,atol (optarg) );
+            break;
+        case 'T':
+            glyr_opt_db_negative_ttl (glyrs,atoi (optarg) );
+            break;
         case 's':
             glyr_opt_musictree_path (glyrs,optarg);
             break;